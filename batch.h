@@ -0,0 +1,353 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "polynomial.h"
+#include "poly_gcd.h"
+#include "factor_ring.h"
+#include "factorization.h"
+#include "result_cache.h"
+#include "poly_io.h"
+#include "modint.h"
+#include "dynmodint.h"
+
+using namespace std;
+
+//////////////////////////////
+// batch.h
+//////////////////////////////
+
+// Non-interactive mode: a stream of operation records is read from a file or stdin and
+// processed in one process, with one compact result line per record.
+//
+// Records are whitespace-separated tokens; '#' starts a comment that runs to the end of
+// the line. A polynomial is written as its coefficient count followed by the
+// coefficients, constant term first ("3 1 0 2" is 1 + 2x^2); results use the same form.
+//
+//   mod P       switch to coefficients in Z_P (P prime); "mod 0" switches back to reals.
+//               The field stays in effect for the following records. No output.
+//   add A B     A + B
+//   sub A B     A - B
+//   mul A B     A * B
+//   div A B     quotient and remainder, both on one line
+//   pow A e     A^e
+//   eval A x    A(x)
+//   gcd A B     monic gcd (Z_P only)
+//   factor A    unit, factor count, then multiplicity and polynomial of each factor (Z_P only)
+//   irred F     1 if F is irreducible, else 0 (Z_P only)
+//   inv A F     the inverse of A modulo F (Z_P only)
+//   save A PATH writes A to the binary file PATH (poly_io.h); prints its coefficient count
+//   load PATH   the polynomial stored in PATH, which must match the current field
+//
+// Irreducibility verdicts, moduli and inverses are kept in RingCache (result_cache.h), so
+// streams that reuse the same moduli pay for each only once.
+//
+// A record that fails writes "error <message>"; after a parse error the rest of its
+// input line is skipped, so keep one record per line.
+
+// Buffered token reader over a FILE*, much faster than iostream extraction.
+class FastReader {
+public:
+    explicit FastReader(FILE* f) : file(f), buf(1 << 16) {}
+
+    // Next token, or an empty view at the end of input. The view stays valid until the
+    // next call.
+    string_view token() {
+        for (;;) {
+            if(pos == len && !refill())
+                return {};
+            char c = buf[pos];
+            if(c == '#') {
+                skip_line();
+            } else if(c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                pos++;
+            } else {
+                break;
+            }
+        }
+        size_t start = pos;
+        for (;;) {
+            while(pos < len && !is_space(buf[pos]))
+                pos++;
+            if(pos < len)
+                break;
+            // The token reaches the end of the buffer: move it to the front and read more.
+            if(start > 0) {
+                memmove(buf.data(), buf.data() + start, len - start);
+                len -= start;
+                pos = len;
+                start = 0;
+            }
+            if(len == buf.size())
+                buf.resize(2 * buf.size());
+            size_t got = fread(buf.data() + len, 1, buf.size() - len, file);
+            if(got == 0)
+                break;
+            len += got;
+        }
+        return string_view(buf.data() + start, pos - start);
+    }
+
+    template<typename N>
+    N number() {
+        string_view t = token();
+        if(t.empty())
+            throw runtime_error("Unexpected end of input");
+        N value{};
+        const char* first = t.data() + (t[0] == '+');
+        auto [end, ec] = from_chars(first, t.data() + t.size(), value);
+        if(ec != errc() || end != t.data() + t.size())
+            throw runtime_error("Bad number '" + string(t) + "'");
+        return value;
+    }
+
+    void skip_line() {
+        for (;;) {
+            if(pos == len && !refill())
+                return;
+            if(buf[pos++] == '\n')
+                return;
+        }
+    }
+
+private:
+    FILE* file;
+    vector<char> buf;
+    size_t pos = 0, len = 0;
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '#';
+    }
+
+    bool refill() {
+        len = fread(buf.data(), 1, buf.size(), file);
+        pos = 0;
+        return len > 0;
+    }
+};
+
+// Buffered writer for result lines. Output is only flushed at line ends, so a record that
+// fails halfway can take back what it wrote.
+class FastWriter {
+public:
+    explicit FastWriter(FILE* f) : file(f) {
+        buf.reserve(1 << 16);
+    }
+    ~FastWriter() {
+        flush();
+    }
+
+    void write(string_view s) {
+        buf.append(s);
+    }
+    template<typename N>
+    void number(N value) {
+        char tmp[64];
+        auto [end, ec] = to_chars(tmp, tmp + sizeof(tmp), value);
+        buf.append(tmp, end - tmp);
+    }
+    size_t mark() const {
+        return buf.size();
+    }
+    void rollback(size_t m) {
+        buf.resize(m);
+    }
+    void end_line() {
+        buf.push_back('\n');
+        if(buf.size() >= (1 << 16))
+            flush();
+    }
+    void flush() {
+        fwrite(buf.data(), 1, buf.size(), file);
+        buf.clear();
+    }
+
+private:
+    FILE* file;
+    string buf;
+};
+
+template<typename T>
+T read_batch_value(FastReader& in) {
+    if constexpr (is_floating_point_v<T>)
+        return in.number<T>();
+    else
+        return T(in.number<long long>());
+}
+
+template<typename T>
+void write_batch_value(FastWriter& out, const T& v) {
+    if constexpr (is_floating_point_v<T>)
+        out.number(v);
+    else
+        out.number(v.val());
+}
+
+template<typename T>
+Polynomial<T> read_batch_polynomial(FastReader& in) {
+    long long n = in.number<long long>();
+    if(n < 0)
+        throw runtime_error("Negative coefficient count");
+    vector<T> coeff;
+    coeff.reserve(min(n, 1LL << 20));
+    for (long long i = 0; i < n; i++)
+        coeff.push_back(read_batch_value<T>(in));
+    return Polynomial<T>(coeff);
+}
+
+template<typename T>
+void write_batch_polynomial(FastWriter& out, const Polynomial<T>& p) {
+    out.number(p.coeffs.size());
+    for (const T& c : p.coeffs) {
+        out.write(" ");
+        write_batch_value(out, c);
+    }
+}
+
+// Processes one record whose op name has been read. Field-only ops are rejected for
+// real coefficients.
+template<typename T>
+void run_batch_op(string_view op, FastReader& in, FastWriter& out) {
+    constexpr bool field = !is_floating_point_v<T>;
+    if(op == "add" || op == "sub" || op == "mul" || op == "div" || op == "gcd") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        Polynomial<T> b = read_batch_polynomial<T>(in);
+        if(op == "add") {
+            write_batch_polynomial(out, a + b);
+        } else if(op == "sub") {
+            write_batch_polynomial(out, a - b);
+        } else if(op == "mul") {
+            write_batch_polynomial(out, a * b);
+        } else if(op == "div") {
+            auto [quotient, remainder] = a.divmod(b);
+            write_batch_polynomial(out, quotient);
+            out.write(" ");
+            write_batch_polynomial(out, remainder);
+        } else {
+            if constexpr (field)
+                write_batch_polynomial(out, poly_gcd(a, b));
+            else
+                throw runtime_error("gcd needs a prime field (use mod P)");
+        }
+    } else if(op == "pow") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        long long e = in.number<long long>();
+        if(e < 0 || e > UINT32_MAX)
+            throw runtime_error("Exponent out of range");
+        write_batch_polynomial(out, a.pow((unsigned int)e));
+    } else if(op == "eval") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        write_batch_value(out, a.evaluate(read_batch_value<T>(in)));
+    } else if(op == "factor") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        if constexpr (field) {
+            if(a.degree() < 0)
+                throw runtime_error("Cannot factor the zero polynomial");
+            Factorization<T> result = factor(a);
+            write_batch_value(out, result.unit);
+            out.write(" ");
+            out.number(result.factors.size());
+            for (auto &[f, multiplicity] : result.factors) {
+                out.write(" ");
+                out.number(multiplicity);
+                out.write(" ");
+                write_batch_polynomial(out, f);
+            }
+        } else {
+            throw runtime_error("factor needs a prime field (use mod P)");
+        }
+    } else if(op == "save") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        string path(in.token());
+        if(path.empty())
+            throw runtime_error("Unexpected end of input");
+        write_polynomial(path, a);
+        out.number(a.coeffs.size());
+    } else if(op == "load") {
+        string path(in.token());
+        if(path.empty())
+            throw runtime_error("Unexpected end of input");
+        write_batch_polynomial(out, load_polynomial<T>(path));
+    } else if(op == "irred" || op == "inv") {
+        Polynomial<T> a = read_batch_polynomial<T>(in);
+        if constexpr (field) {
+            RingCache<T>& cache = RingCache<T>::shared();
+            if(op == "irred") {
+                out.number(cache.is_irreducible(a) ? 1 : 0);
+            } else {
+                Polynomial<T> f = read_batch_polynomial<T>(in);
+                if(f.degree() < 0)
+                    throw runtime_error("Factor ring modulus must be nonzero");
+                write_batch_polynomial(out, cache.inverse(cache.element(a, f)).poly);
+            }
+        } else {
+            throw runtime_error(string(op) + " needs a prime field (use mod P)");
+        }
+    } else {
+        throw runtime_error("Unknown operation '" + string(op) + "'");
+    }
+}
+
+// Runs every record of `input`, writing one line per record (except "mod") to `output`.
+// Returns the number of records that failed.
+inline size_t run_batch(FILE* input, FILE* output) {
+    FastReader in(input);
+    FastWriter out(output);
+    long long prime = 0; // 0: real coefficients
+    size_t failures = 0;
+    for (string_view op = in.token(); !op.empty(); op = in.token()) {
+        size_t mark = out.mark();
+        try {
+            if(op == "mod") {
+                long long p = in.number<long long>();
+                if(p != 0 && !is_prime_u64(p < 0 ? 0 : (uint64_t)p))
+                    throw runtime_error(to_string(p) + " is not a prime number");
+                if(p >= (1LL << 62))
+                    throw runtime_error("Prime " + to_string(p) + " is too large (the limit is 2^62)");
+                // The Montgomery context is only rebuilt when the prime changes.
+                if(p > 2 && (uint64_t)p != DynModInt<>::mod())
+                    DynModInt<>::set_mod(p);
+                prime = p;
+                continue;
+            }
+            string name(op); // op is invalidated by further reads
+            if(prime == 0)
+                run_batch_op<double>(name, in, out);
+            else if(prime == 2)
+                run_batch_op<ModInt<2>>(name, in, out);
+            else
+                run_batch_op<DynModInt<>>(name, in, out);
+        } catch (const exception &e) {
+            out.rollback(mark);
+            out.write("error ");
+            out.write(e.what());
+            in.skip_line();
+            failures++;
+        }
+        out.end_line();
+    }
+    return failures;
+}
+
+// polycalc --batch [path]: runs the records of the file (stdin if path is null) and
+// returns the exit status: 0 if every record succeeded, 1 if the file cannot be opened,
+// 2 if any record failed.
+inline int batch_main(const char* path, FILE* output = stdout) {
+    FILE* input = stdin;
+    if(path && !(input = fopen(path, "rb"))) {
+        cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    size_t failures = run_batch(input, output);
+    if(input != stdin)
+        fclose(input);
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,308 @@
+#include "polynomial.h"
+#include "factor_ring.h"
+#include "modint.h"
+#include "dynmodint.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+
+
+
+//////////////////////////////
+// bench.cpp
+//////////////////////////////
+
+// Benchmarks for the arithmetic kernels: Polynomial::operator* and divmod over double and
+// several prime fields, FactorRingElement::inv and pow, and is_irreducible, each swept
+// over the degree. For every case it reports ns/op, throughput (input coefficients per
+// second) and heap allocations per op.
+//
+//   g++ -std=c++20 -O2 -pthread bench.cpp -o polybench
+//   polybench [--filter S] [--min-time SEC] [--max-degree N]
+//             [--json out.json] [--baseline base.json] [--threshold PCT]
+//
+// With --baseline, every case present in both runs is compared by ns/op, and cases that
+// got slower by more than the threshold (default 10%) are flagged; the exit status is 1
+// if any were.
+
+//////////////////////////////
+// Allocation counting
+//////////////////////////////
+
+static atomic<uint64_t> alloc_count{0}, alloc_bytes{0};
+
+// Kept out of line so that GCC does not pair the inlined malloc/free with new/delete
+// expressions and warn about a mismatch.
+__attribute__((noinline)) void* operator new(size_t size) {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add(size, memory_order_relaxed);
+    if(void* p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+__attribute__((noinline)) void* operator new[](size_t size) {
+    return operator new(size);
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    free(p);
+}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+//////////////////////////////
+// Timing
+//////////////////////////////
+
+struct BenchResult {
+    string name;
+    double ns_per_op;
+    double coeffs_per_s;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+struct BenchOptions {
+    string filter;
+    double min_time = 0.1; // seconds per sample
+    int max_degree = 1 << 13;
+};
+
+// Keeps results alive so the compiler cannot drop the measured work.
+static volatile size_t bench_sink;
+
+// Runs op in batches long enough to last min_time, three samples, and keeps the fastest.
+// `coeffs` is the number of input coefficients one op processes.
+template<typename Op>
+BenchResult measure(const string& name, double coeffs, const BenchOptions& opt, Op op) {
+    typedef chrono::steady_clock Clock;
+    bench_sink = bench_sink + op(); // warm-up, also fills caches such as twiddle tables
+    uint64_t iters = 1;
+    double best = 1e300, allocs = 0, bytes = 0;
+    for (int sample = 0; sample < 3; ) {
+        uint64_t count0 = alloc_count.load(), bytes0 = alloc_bytes.load();
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < iters; i++)
+            bench_sink = bench_sink + op();
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        if(elapsed < opt.min_time && sample == 0 && iters < (1ULL << 40)) {
+            // Grow the batch towards min_time before taking samples.
+            iters = elapsed <= 0 ? iters * 10 : max(iters * 2, (uint64_t)(iters * 1.2 * opt.min_time / elapsed));
+            continue;
+        }
+        best = min(best, elapsed / iters);
+        allocs = double(alloc_count.load() - count0) / iters;
+        bytes = double(alloc_bytes.load() - bytes0) / iters;
+        sample++;
+        // Slow cases (a batch over a second) are sampled once.
+        if(elapsed > 10 * opt.min_time && elapsed > 1.0)
+            break;
+    }
+    return {name, best * 1e9, coeffs / best, allocs, bytes};
+}
+
+void print_result(const BenchResult& r) {
+    cout << left << setw(44) << r.name << right << fixed << setprecision(1)
+         << setw(16) << r.ns_per_op << " ns/op"
+         << setw(12) << setprecision(2) << r.coeffs_per_s / 1e6 << " Mcoef/s"
+         << setw(10) << setprecision(1) << r.allocs_per_op << " allocs/op"
+         << setw(12) << setprecision(1) << r.bytes_per_op / 1024 << " KiB/op\n";
+}
+
+// Prints a result as soon as it is measured and keeps it for the JSON report.
+void add_result(vector<BenchResult>& out, const BenchResult& r) {
+    print_result(r);
+    out.push_back(r);
+}
+
+//////////////////////////////
+// Cases
+//////////////////////////////
+
+template<typename T>
+string type_name() {
+    if constexpr (is_same_v<T, double>)
+        return "double";
+    else if constexpr (is_same_v<T, DynModInt<>>)
+        return "DynModInt<" + to_string(T::mod()) + ">";
+    else
+        return "ModInt<" + to_string(T::mod()) + ">";
+}
+
+template<typename T>
+Polynomial<T> random_polynomial(int degree, mt19937_64& rng) {
+    vector<T> c(degree + 1);
+    for (auto &x : c) {
+        if constexpr (is_same_v<T, double>)
+            x = (double)(long long)(rng() % 2001) - 1000;
+        else
+            x = T((long long)(rng() >> 2));
+    }
+    if(c.back() == T(0))
+        c.back() = T(1);
+    return Polynomial<T>(c);
+}
+
+template<typename T>
+void bench_arithmetic(const BenchOptions& opt, vector<BenchResult>& out, const function<bool(const string&)>& wanted) {
+    mt19937_64 rng(1);
+    for (int n = 16; n <= opt.max_degree; n *= 8) {
+        string suffix = "/" + type_name<T>() + "/n=" + to_string(n);
+        if(wanted("mul" + suffix)) {
+            Polynomial<T> a = random_polynomial<T>(n, rng), b = random_polynomial<T>(n, rng);
+            add_result(out, measure("mul" + suffix, 2.0 * (n + 1), opt, [&] { return (a * b).coeffs.size(); }));
+        }
+        if(wanted("divmod" + suffix)) {
+            Polynomial<T> a = random_polynomial<T>(2 * n, rng), b = random_polynomial<T>(n, rng);
+            add_result(out, measure("divmod" + suffix, 3.0 * n + 2, opt, [&] {
+                auto [q, r] = a.divmod(b);
+                return q.coeffs.size() + r.coeffs.size();
+            }));
+        }
+    }
+}
+
+template<typename T>
+void bench_field(const BenchOptions& opt, vector<BenchResult>& out, const function<bool(const string&)>& wanted) {
+    mt19937_64 rng(2);
+    for (int n = 8; n <= min(opt.max_degree, 512); n *= 4) {
+        string suffix = "/" + type_name<T>() + "/n=" + to_string(n);
+        bool ring = wanted("ring_inv" + suffix) || wanted("ring_pow" + suffix);
+        bool irred = n <= 128 && wanted("is_irreducible" + suffix);
+        if(!ring && !irred)
+            continue;
+        Polynomial<T> f = random_irreducible<T>(n, rng);
+        if(ring) {
+            auto ctx = make_shared<const ModulusContext<T>>(f);
+            FactorRingElement<T> a(random_polynomial<T>(n - 1, rng), ctx);
+            unsigned long long e = rng();
+            if(wanted("ring_inv" + suffix))
+                add_result(out, measure("ring_inv" + suffix, n, opt, [&] { return a.inv().poly.coeffs.size(); }));
+            if(wanted("ring_pow" + suffix))
+                add_result(out, measure("ring_pow" + suffix, n, opt, [&] { return a.pow(e).poly.coeffs.size(); }));
+        }
+        if(irred)
+            add_result(out, measure("is_irreducible" + suffix, n + 1, opt, [&] { return (size_t)is_irreducible(f); }));
+    }
+}
+
+//////////////////////////////
+// JSON report and baseline comparison
+//////////////////////////////
+
+void write_json(const string& path, const vector<BenchResult>& results) {
+    ofstream os(path);
+    if(!os)
+        throw runtime_error("Cannot open " + path);
+    os << "{\n  \"version\": 1,\n  \"results\": [\n";
+    os << setprecision(6);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        // One case per line, which is what read_baseline() relies on.
+        os << "    {\"name\": \"" << r.name << "\", \"ns_per_op\": " << r.ns_per_op
+           << ", \"coeffs_per_s\": " << r.coeffs_per_s << ", \"allocs_per_op\": " << r.allocs_per_op
+           << ", \"bytes_per_op\": " << r.bytes_per_op << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// Reads name -> ns/op from a file written by write_json.
+map<string, double> read_baseline(const string& path) {
+    ifstream is(path);
+    if(!is)
+        throw runtime_error("Cannot open " + path);
+    map<string, double> base;
+    string line;
+    while(getline(is, line)) {
+        size_t n = line.find("\"name\": \""), t = line.find("\"ns_per_op\": ");
+        if(n == string::npos || t == string::npos)
+            continue;
+        n += 9;
+        size_t end = line.find('"', n);
+        base[line.substr(n, end - n)] = strtod(line.c_str() + t + 13, nullptr);
+    }
+    return base;
+}
+
+// Prints the comparison and returns the number of regressions.
+int compare_baseline(const vector<BenchResult>& results, const map<string, double>& base, double threshold) {
+    int regressions = 0;
+    cout << "\nComparison with baseline (threshold " << threshold << "%):\n";
+    for (const BenchResult& r : results) {
+        auto it = base.find(r.name);
+        if(it == base.end() || it->second <= 0)
+            continue;
+        double change = (r.ns_per_op / it->second - 1) * 100;
+        bool slower = change > threshold;
+        regressions += slower;
+        cout << left << setw(44) << r.name << right << fixed << setprecision(1)
+             << setw(16) << it->second << " -> " << setw(14) << r.ns_per_op << " ns/op"
+             << setw(9) << showpos << change << noshowpos << "%"
+             << (slower ? "  REGRESSION" : "") << "\n";
+    }
+    cout << regressions << " regression(s)\n";
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    string json_path, baseline_path;
+    double threshold = 10;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(i + 1 >= argc) {
+            cerr << "Missing value for " << arg << "\n";
+            return 2;
+        }
+        string value = argv[++i];
+        if(arg == "--filter") opt.filter = value;
+        else if(arg == "--min-time") opt.min_time = stod(value);
+        else if(arg == "--max-degree") opt.max_degree = stoi(value);
+        else if(arg == "--json") json_path = value;
+        else if(arg == "--baseline") baseline_path = value;
+        else if(arg == "--threshold") threshold = stod(value);
+        else {
+            cerr << "Unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+    auto wanted = [&](const string& name) {
+        return name.find(opt.filter) != string::npos;
+    };
+
+    DynModInt<>::set_mod((1ULL << 61) - 1);
+    vector<BenchResult> results;
+    try {
+        bench_arithmetic<double>(opt, results, wanted);
+        bench_arithmetic<ModInt<2>>(opt, results, wanted);
+        bench_arithmetic<ModInt<1000003>>(opt, results, wanted);
+        bench_arithmetic<ModInt<998244353>>(opt, results, wanted);
+        bench_arithmetic<DynModInt<>>(opt, results, wanted);
+        bench_field<ModInt<2>>(opt, results, wanted);
+        bench_field<ModInt<1000003>>(opt, results, wanted);
+        bench_field<ModInt<998244353>>(opt, results, wanted);
+        bench_field<DynModInt<>>(opt, results, wanted);
+        if(!json_path.empty())
+            write_json(json_path, results);
+        if(!baseline_path.empty())
+            return compare_baseline(results, read_baseline(baseline_path), threshold) > 0 ? 1 : 0;
+    } catch (const exception &e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,451 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "convolution.h"
+#include "ntt.h"
+
+using namespace std;
+
+//////////////////////////////
+// bigint.h
+//////////////////////////////
+
+// Arbitrary-size signed integers (sign and magnitude, base 2^32 limbs, least significant
+// first) and exact products of Polynomial<BigInt>.
+//
+// Long polynomial products are computed modulo k of the NTT primes (ntt.h) and recombined
+// with Garner's algorithm. k is the smallest count whose prime product exceeds twice the
+// coefficient bound len * max|a_i| * max|b_j|, so the exact product costs about k modular
+// products; results are read in the symmetric range (-M/2, M/2). Products whose bound
+// exceeds the whole prime set fall back to Karatsuba on BigInt coefficients.
+
+// Limb counts from which BigInt multiplication uses Karatsuba.
+inline constexpr size_t BIGINT_KARATSUBA_LIMBS = 48;
+
+class BigInt {
+public:
+    bool negative = false;
+    vector<uint32_t> mag; // |value|, no zero top limb; empty for zero.
+
+    BigInt() {}
+    BigInt(long long v) {
+        negative = v < 0;
+        unsigned long long u = negative ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+        while(u) {
+            mag.push_back((uint32_t)u);
+            u >>= 32;
+        }
+    }
+    // Decimal string with an optional sign.
+    explicit BigInt(const string& s) {
+        size_t i = 0;
+        bool neg = false;
+        if(i < s.size() && (s[i] == '-' || s[i] == '+'))
+            neg = s[i++] == '-';
+        if(i == s.size())
+            throw invalid_argument("Not an integer: " + s);
+        // Nine digits at a time: mag = mag * 10^len + chunk.
+        while(i < s.size()) {
+            size_t len = min<size_t>(9, s.size() - i);
+            uint32_t chunk = 0, scale = 1;
+            for (size_t j = 0; j < len; j++, i++) {
+                if(s[i] < '0' || s[i] > '9')
+                    throw invalid_argument("Not an integer: " + s);
+                chunk = chunk * 10 + (s[i] - '0');
+                scale *= 10;
+            }
+            mul_add_small(scale, chunk);
+        }
+        negative = neg && !mag.empty();
+    }
+
+    bool is_zero() const {
+        return mag.empty();
+    }
+    int sign() const {
+        return mag.empty() ? 0 : negative ? -1 : 1;
+    }
+    // Number of bits of |value|.
+    size_t bit_length() const {
+        return mag.empty() ? 0 : mag.size() * 32 - __builtin_clz(mag.back());
+    }
+
+    // value * 2^(32 k).
+    BigInt shifted_limbs(size_t k) const {
+        BigInt r = *this;
+        if(!r.mag.empty())
+            r.mag.insert(r.mag.begin(), k, 0);
+        return r;
+    }
+    // |value| mod m for m < 2^32.
+    uint32_t mod_small(uint32_t m) const {
+        uint64_t r = 0;
+        for (size_t i = mag.size(); i-- > 0;)
+            r = ((r << 32) | mag[i]) % m;
+        return (uint32_t)r;
+    }
+    // |value| = |value| * m + a.
+    void mul_add_small(uint32_t m, uint32_t a) {
+        uint64_t carry = a;
+        for (auto &limb : mag) {
+            uint64_t t = (uint64_t)limb * m + carry;
+            limb = (uint32_t)t;
+            carry = t >> 32;
+        }
+        if(carry)
+            mag.push_back((uint32_t)carry);
+        trim();
+    }
+    // |value| = |value| / m; returns the remainder.
+    uint32_t div_small(uint32_t m) {
+        uint64_t r = 0;
+        for (size_t i = mag.size(); i-- > 0;) {
+            uint64_t cur = (r << 32) | mag[i];
+            mag[i] = (uint32_t)(cur / m);
+            r = cur % m;
+        }
+        trim();
+        if(mag.empty())
+            negative = false;
+        return (uint32_t)r;
+    }
+
+    string to_string() const {
+        if(mag.empty())
+            return "0";
+        BigInt t = *this;
+        vector<uint32_t> chunks; // base 10^9, least significant first
+        while(!t.mag.empty())
+            chunks.push_back(t.div_small(1000000000));
+        string s = negative ? "-" : "";
+        s += std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            string part = std::to_string(chunks[i]);
+            s += string(9 - part.size(), '0') + part;
+        }
+        return s;
+    }
+
+    BigInt operator-() const {
+        BigInt r = *this;
+        if(!r.mag.empty())
+            r.negative = !r.negative;
+        return r;
+    }
+    BigInt& operator+=(const BigInt& o) {
+        if(negative == o.negative) {
+            add_mag(mag, o.mag);
+        } else if(compare_mag(mag, o.mag) >= 0) {
+            sub_mag(mag, o.mag);
+        } else {
+            vector<uint32_t> m = o.mag;
+            sub_mag(m, mag);
+            mag.swap(m);
+            negative = o.negative;
+        }
+        if(mag.empty())
+            negative = false;
+        return *this;
+    }
+    BigInt& operator-=(const BigInt& o) {
+        return *this += -o;
+    }
+    BigInt& operator*=(const BigInt& o) {
+        return *this = *this * o;
+    }
+    friend BigInt operator+(BigInt a, const BigInt& b) { return a += b; }
+    friend BigInt operator-(BigInt a, const BigInt& b) { return a -= b; }
+    friend BigInt operator*(const BigInt& a, const BigInt& b) {
+        BigInt r;
+        if(a.mag.empty() || b.mag.empty())
+            return r;
+        r.mag = mul_mag(a.mag, b.mag);
+        r.negative = a.negative != b.negative;
+        return r;
+    }
+
+    friend bool operator==(const BigInt& a, const BigInt& b) {
+        return a.negative == b.negative && a.mag == b.mag;
+    }
+    friend bool operator!=(const BigInt& a, const BigInt& b) {
+        return !(a == b);
+    }
+    friend bool operator<(const BigInt& a, const BigInt& b) {
+        if(a.negative != b.negative)
+            return a.negative;
+        int c = compare_mag(a.mag, b.mag);
+        return a.negative ? c > 0 : c < 0;
+    }
+
+    friend ostream& operator<<(ostream& os, const BigInt& v) {
+        return os << v.to_string();
+    }
+    friend istream& operator>>(istream& is, BigInt& v) {
+        string s;
+        if(is >> s) {
+            try {
+                v = BigInt(s);
+            } catch (const invalid_argument&) {
+                is.setstate(ios::failbit);
+            }
+        }
+        return is;
+    }
+
+    static int compare_mag(const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        if(a.size() != b.size())
+            return a.size() < b.size() ? -1 : 1;
+        for (size_t i = a.size(); i-- > 0;)
+            if(a[i] != b[i])
+                return a[i] < b[i] ? -1 : 1;
+        return 0;
+    }
+
+private:
+    void trim() {
+        while(!mag.empty() && mag.back() == 0)
+            mag.pop_back();
+    }
+
+    // a += b.
+    static void add_mag(vector<uint32_t>& a, const vector<uint32_t>& b) {
+        if(a.size() < b.size())
+            a.resize(b.size(), 0);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            uint64_t t = (uint64_t)a[i] + (i < b.size() ? b[i] : 0) + carry;
+            a[i] = (uint32_t)t;
+            carry = t >> 32;
+            if(!carry && i >= b.size())
+                break;
+        }
+        if(carry)
+            a.push_back((uint32_t)carry);
+    }
+    // a -= b, for |a| >= |b|.
+    static void sub_mag(vector<uint32_t>& a, const vector<uint32_t>& b) {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            int64_t t = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = t < 0;
+            a[i] = (uint32_t)(t + (borrow << 32));
+            if(!borrow && i >= b.size())
+                break;
+        }
+        while(!a.empty() && a.back() == 0)
+            a.pop_back();
+    }
+
+    // res[0 .. n+m) += a * b.
+    static void mul_schoolbook(const uint32_t* a, size_t n, const uint32_t* b, size_t m, uint32_t* res) {
+        for (size_t i = 0; i < n; i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < m; j++) {
+                uint64_t t = (uint64_t)a[i] * b[j] + res[i+j] + carry;
+                res[i+j] = (uint32_t)t;
+                carry = t >> 32;
+            }
+            for (size_t k = i + m; carry; k++) {
+                uint64_t t = (uint64_t)res[k] + carry;
+                res[k] = (uint32_t)t;
+                carry = t >> 32;
+            }
+        }
+    }
+
+    static vector<uint32_t> mul_mag(const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        vector<uint32_t> res;
+        if(min(a.size(), b.size()) < BIGINT_KARATSUBA_LIMBS) {
+            res.assign(a.size() + b.size() + 1, 0);
+            mul_schoolbook(a.data(), a.size(), b.data(), b.size(), res.data());
+        } else {
+            // (a1 B + a0)(b1 B + b0) = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0
+            size_t h = max(a.size(), b.size()) / 2;
+            auto low = [h](const vector<uint32_t>& v) {
+                vector<uint32_t> r(v.begin(), v.begin() + min(h, v.size()));
+                while(!r.empty() && r.back() == 0)
+                    r.pop_back();
+                return r;
+            };
+            auto high = [h](const vector<uint32_t>& v) {
+                return v.size() > h ? vector<uint32_t>(v.begin() + h, v.end()) : vector<uint32_t>();
+            };
+            vector<uint32_t> a0 = low(a), a1 = high(a), b0 = low(b), b1 = high(b);
+            vector<uint32_t> z0 = mul_or_zero(a0, b0), z2 = mul_or_zero(a1, b1);
+            add_mag(a0, a1);
+            add_mag(b0, b1);
+            vector<uint32_t> z1 = mul_or_zero(a0, b0);
+            sub_mag(z1, z0);
+            sub_mag(z1, z2);
+            res.assign(a.size() + b.size() + 1, 0);
+            add_shifted(res, z0, 0);
+            add_shifted(res, z1, h);
+            add_shifted(res, z2, 2 * h);
+        }
+        while(!res.empty() && res.back() == 0)
+            res.pop_back();
+        return res;
+    }
+    static vector<uint32_t> mul_or_zero(const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        return a.empty() || b.empty() ? vector<uint32_t>() : mul_mag(a, b);
+    }
+    // res += v * B^shift; res is long enough for the result.
+    static void add_shifted(vector<uint32_t>& res, const vector<uint32_t>& v, size_t shift) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < v.size() || carry; i++) {
+            uint64_t t = (uint64_t)res[i+shift] + (i < v.size() ? v[i] : 0) + carry;
+            res[i+shift] = (uint32_t)t;
+            carry = t >> 32;
+        }
+    }
+};
+
+//////////////////////////////
+// Exact polynomial products over Z
+//////////////////////////////
+
+// Number of NTT primes whose product exceeds 2 * len * 2^(bits_a + bits_b), or 0 if even
+// all of them are not enough.
+inline int bigint_primes_needed(size_t len, size_t bits_a, size_t bits_b) {
+    double need = log2((double)max<size_t>(len, 1)) + bits_a + bits_b + 1;
+    double have = 0;
+    for (int i = 0; i < NTT_PRIME_COUNT; i++) {
+        have += log2((double)NTT_PRIMES[i]);
+        if(have > need)
+            return i + 1;
+    }
+    return 0;
+}
+
+// Residues of the coefficients modulo p, in [0, p).
+inline vector<uint64_t> bigint_residues(const vector<BigInt>& a, uint32_t p) {
+    vector<uint64_t> r(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        uint32_t m = a[i].mod_small(p);
+        r[i] = a[i].negative && m ? p - m : m;
+    }
+    return r;
+}
+
+// Signed product of two integer sequences known through their residues: residues_a(p)
+// and residues_b(p) give the sequences modulo p. The len coefficients of the product
+// must be below half the product of the first k NTT primes in absolute value.
+template<typename RA, typename RB>
+vector<BigInt> convolve_crt_signed(RA residues_a, RB residues_b, bool square, size_t len, int k) {
+    vector<vector<uint64_t>> residues(k);
+    // As in convolve_crt, short products never start the shared pool.
+    bool parallel = parallel_worthwhile(len, NTT_PARALLEL_MIN);
+    auto transform = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++) {
+            vector<uint64_t> ra = residues_a(NTT_PRIMES[i]);
+            residues[i] = square ? convolve_residues_by_index(i, ra, ra)
+                                 : convolve_residues_by_index(i, ra, residues_b(NTT_PRIMES[i]));
+        }
+    };
+    if(parallel)
+        parallel_for(0, k, 1, transform);
+    else
+        transform(0, k);
+    // inv[j][i] = p_j^(-1) mod p_i for j < i.
+    vector<vector<uint64_t>> inv(k, vector<uint64_t>(k, 0));
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < i; j++)
+            inv[j][i] = ntt_pow_mod(NTT_PRIMES[j] % NTT_PRIMES[i], NTT_PRIMES[i] - 2, NTT_PRIMES[i]);
+    BigInt modulus(1); // p_0 * ... * p_(k-1)
+    for (int i = 0; i < k; i++)
+        modulus.mul_add_small(NTT_PRIMES[i], 0);
+    BigInt half = modulus;
+    half.div_small(2);
+    vector<BigInt> res(len);
+    auto recombine = [&](size_t lo, size_t hi) {
+        vector<uint64_t> digits(k);
+        for (size_t t = lo; t < hi; t++) {
+            for (int i = 0; i < k; i++) {
+                uint64_t p = NTT_PRIMES[i];
+                uint64_t x = residues[i][t];
+                for (int j = 0; j < i; j++)
+                    x = (x + p - digits[j] % p) % p * inv[j][i] % p;
+                digits[i] = x;
+            }
+            // Horner in the mixed radix: x_0 + p_0 (x_1 + p_1 (x_2 + ...)).
+            BigInt v;
+            for (int i = k; i-- > 0;)
+                v.mul_add_small(NTT_PRIMES[i], (uint32_t)digits[i]);
+            if(half < v)
+                v -= modulus;
+            res[t] = move(v);
+        }
+    };
+    if(parallel)
+        parallel_for(0, len, NTT_PARALLEL_GRAIN, recombine);
+    else
+        recombine(0, len);
+    return res;
+}
+
+// Coefficients that are too wide for the prime set are cut into their 32-bit limbs, and
+// the limbs of each coefficient are laid out in a slot of d = da + db - 1 consecutive
+// entries (Kronecker substitution), where da and db are the most limbs in a and b. Slots
+// do not overlap in the product, and entry u of slot t holds the sum of limb products of
+// weight 2^(32u) in c_t; every entry is below len * 2^64, which three primes cover.
+inline vector<BigInt> convolve_bigint_limbs(const vector<BigInt>& a, const vector<BigInt>& b, int k) {
+    size_t da = 1, db = 1;
+    for (const BigInt& c : a)
+        da = max(da, c.mag.size());
+    for (const BigInt& c : b)
+        db = max(db, c.mag.size());
+    size_t d = da + db - 1, len = a.size() + b.size() - 1;
+    auto spread = [d](const vector<BigInt>& v, uint32_t p) {
+        vector<uint64_t> r(v.size() * d, 0);
+        for (size_t i = 0; i < v.size(); i++) {
+            for (size_t j = 0; j < v[i].mag.size(); j++) {
+                uint64_t limb = v[i].mag[j] % p;
+                r[i*d + j] = v[i].negative && limb ? p - limb : limb;
+            }
+        }
+        return r;
+    };
+    vector<BigInt> slots = convolve_crt_signed([&](uint32_t p) { return spread(a, p); },
+                                               [&](uint32_t p) { return spread(b, p); },
+                                               &a == &b, len * d, k);
+    vector<BigInt> res(len);
+    for (size_t t = 0; t < len; t++)
+        for (size_t u = d; u-- > 0;)
+            res[t] = res[t].shifted_limbs(1) + slots[t*d + u];
+    return res;
+}
+
+// Exact Polynomial<BigInt> product: schoolbook for short operands, then the multi-prime
+// NTT, directly when the coefficient bound fits the prime set and on 32-bit limbs when it
+// does not. Karatsuba is left for products longer than the NTT primes support.
+inline vector<BigInt> convolve(const vector<BigInt>& a, const vector<BigInt>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    size_t shorter = min(a.size(), b.size()), len = a.size() + b.size() - 1;
+    if(shorter <= KARATSUBA_THRESHOLD) {
+        vector<BigInt> res(len);
+        convolve_schoolbook_add(a.data(), a.size(), b.data(), b.size(), res.data());
+        return res;
+    }
+    size_t bits_a = 0, bits_b = 0;
+    for (const BigInt& c : a)
+        bits_a = max(bits_a, c.bit_length());
+    for (const BigInt& c : b)
+        bits_b = max(bits_b, c.bit_length());
+    const size_t max_len = (size_t)1 << NTT_CRT_MAX_LOG;
+    if(int k = bigint_primes_needed(shorter, bits_a, bits_b); k > 0 && len <= max_len) {
+        return convolve_crt_signed([&](uint32_t p) { return bigint_residues(a, p); },
+                                   [&](uint32_t p) { return bigint_residues(b, p); },
+                                   &a == &b, len, k);
+    }
+    size_t slot = (max<size_t>(bits_a, 1) + 31) / 32 + (max<size_t>(bits_b, 1) + 31) / 32 - 1;
+    if(int k = bigint_primes_needed(shorter * slot, 32, 32); k > 0 && len * slot <= max_len)
+        return convolve_bigint_limbs(a, b, k);
+    return convolve_karatsuba(a, b);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "thread_pool.h"
+
+using namespace std;
+
+//////////////////////////////
+// convolution.h
+//////////////////////////////
+
+// Multiplication kernels for coefficient vectors (coeffs[i] corresponds to x^i).
+// Polynomial<T>::operator* calls convolve(), which picks schoolbook or Karatsuba
+// from the operand sizes. Coefficient types with a faster transform provide a more
+// specialized convolve() overload (see ntt.h for ModInt<MOD>, fft.h for double).
+
+// Below this operand length the quadratic loop is faster than Karatsuba.
+inline constexpr size_t KARATSUBA_THRESHOLD = 32;
+// From this operand length on, the three half-size products run as parallel tasks.
+inline constexpr size_t KARATSUBA_PARALLEL_MIN = 2048;
+
+// Schoolbook product: res[i+j] += a[i] * b[j]. res must hold n + m - 1 entries.
+template<typename T>
+void convolve_schoolbook_add(const T* a, size_t n, const T* b, size_t m, T* res) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < m; j++) {
+            res[i+j] = res[i+j] + a[i] * b[j];
+        }
+    }
+}
+
+// Karatsuba product of two length-n operands: res[0 .. 2n-2] += a * b.
+template<typename T>
+void karatsuba_add(const T* a, const T* b, size_t n, T* res) {
+    if(n <= KARATSUBA_THRESHOLD) {
+        convolve_schoolbook_add(a, n, b, n, res);
+        return;
+    }
+    // a = a0 + x^h * a1, where a0 has h coefficients and a1 has k >= h coefficients.
+    size_t h = n / 2, k = n - h;
+    vector<T> z0(2*h - 1, T(0)), z1(2*k - 1, T(0)), z2(2*k - 1, T(0));
+    vector<T> as(a + h, a + n), bs(b + h, b + n);
+    for (size_t i = 0; i < h; i++) {
+        as[i] = as[i] + a[i];
+        bs[i] = bs[i] + b[i];
+    }
+    // The three products write to separate buffers, so they can run concurrently.
+    if(parallel_worthwhile(n, KARATSUBA_PARALLEL_MIN)) {
+        TaskGroup group(ThreadPool::shared());
+        group.run([&] { karatsuba_add(a, b, h, z0.data()); });
+        group.run([&] { karatsuba_add(a + h, b + h, k, z2.data()); });
+        karatsuba_add(as.data(), bs.data(), k, z1.data());
+        group.wait();
+    } else {
+        karatsuba_add(a, b, h, z0.data());
+        karatsuba_add(a + h, b + h, k, z2.data());
+        karatsuba_add(as.data(), bs.data(), k, z1.data());
+    }
+    // z1 = (a0 + a1)(b0 + b1) - a0*b0 - a1*b1
+    for (size_t i = 0; i < z0.size(); i++)
+        z1[i] = z1[i] - z0[i];
+    for (size_t i = 0; i < z2.size(); i++)
+        z1[i] = z1[i] - z2[i];
+    for (size_t i = 0; i < z0.size(); i++)
+        res[i] = res[i] + z0[i];
+    for (size_t i = 0; i < z1.size(); i++)
+        res[i+h] = res[i+h] + z1[i];
+    for (size_t i = 0; i < z2.size(); i++)
+        res[i+2*h] = res[i+2*h] + z2[i];
+}
+
+// Karatsuba for arbitrary sizes: the longer operand is cut into chunks as long as the
+// shorter one, so unbalanced products stay close to O(n * m^0.58).
+template<typename T>
+void convolve_karatsuba_add(const T* a, size_t n, const T* b, size_t m, T* res) {
+    if(n < m) {
+        swap(a, b);
+        swap(n, m);
+    }
+    if(m <= KARATSUBA_THRESHOLD) {
+        convolve_schoolbook_add(a, n, b, m, res);
+        return;
+    }
+    for (size_t s = 0; s < n; s += m) {
+        size_t len = min(m, n - s);
+        if(len == m)
+            karatsuba_add(a + s, b, m, res + s);
+        else
+            convolve_karatsuba_add(a + s, len, b, m, res + s);
+    }
+}
+
+template<typename T>
+vector<T> convolve_karatsuba(const vector<T>& a, const vector<T>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    vector<T> res(a.size() + b.size() - 1, T(0));
+    convolve_karatsuba_add(a.data(), a.size(), b.data(), b.size(), res.data());
+    return res;
+}
+
+// Generic product of two coefficient vectors.
+template<typename T>
+vector<T> convolve(const vector<T>& a, const vector<T>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    if(min(a.size(), b.size()) <= KARATSUBA_THRESHOLD) {
+        vector<T> res(a.size() + b.size() - 1, T(0));
+        convolve_schoolbook_add(a.data(), a.size(), b.data(), b.size(), res.data());
+        return res;
+    }
+    return convolve_karatsuba(a, b);
+}
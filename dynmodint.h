@@ -0,0 +1,193 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+#include "convolution.h"
+#include "ntt.h"
+#include "profile.h"
+
+using namespace std;
+
+//////////////////////////////
+// dynmodint.h
+//////////////////////////////
+
+// Montgomery constants for an odd runtime modulus below 2^62.
+// Residues are stored as a * 2^64 mod m, so a product is one 128-bit multiplication
+// followed by a reduction (REDC) without any division.
+struct MontgomeryContext {
+    uint64_t mod;     // The modulus m.
+    uint64_t neg_inv; // -m^(-1) mod 2^64
+    uint64_t r2;      // 2^128 mod m
+
+    explicit MontgomeryContext(uint64_t m) : mod(m) {
+        if(m < 3 || m % 2 == 0 || m >= (1ULL << 62))
+            throw invalid_argument("Montgomery modulus must be odd, at least 3 and below 2^62");
+        // Newton iteration for m^(-1) mod 2^64; each step doubles the number of correct bits.
+        uint64_t inv = m;
+        for (int i = 0; i < 5; i++)
+            inv *= 2 - m * inv;
+        neg_inv = 0 - inv;
+        uint64_t r = (uint64_t)(((unsigned __int128)1 << 64) % m);
+        r2 = (uint64_t)((unsigned __int128)r * r % m);
+    }
+
+    // t * 2^(-64) mod m, for t < m * 2^64.
+    uint64_t reduce(unsigned __int128 t) const {
+        uint64_t q = (uint64_t)t * neg_inv;
+        uint64_t r = (uint64_t)((t + (unsigned __int128)q * mod) >> 64);
+        return r >= mod ? r - mod : r;
+    }
+    uint64_t mul(uint64_t a, uint64_t b) const {
+        return reduce((unsigned __int128)a * b);
+    }
+    uint64_t to_montgomery(uint64_t x) const {
+        return mul(x % mod, r2);
+    }
+    uint64_t from_montgomery(uint64_t x) const {
+        return reduce(x);
+    }
+};
+
+// Arithmetic modulo a prime chosen at runtime (odd, below 2^62).
+// All DynModInt<ID> values share one MontgomeryContext; use distinct IDs for distinct
+// moduli that are live at the same time. Set the modulus before creating values.
+template<int ID = 0>
+struct DynModInt {
+    uint64_t mont; // The residue in Montgomery form.
+
+    DynModInt() : mont(0) {}
+    template<typename I, typename = enable_if_t<is_integral_v<I>>>
+    DynModInt(I v) {
+        uint64_t m = ctx.mod, r;
+        if constexpr (is_signed_v<I>) {
+            long long s = (long long)v % (long long)m;
+            r = s < 0 ? (uint64_t)(s + (long long)m) : (uint64_t)s;
+        } else {
+            r = (uint64_t)v % m;
+        }
+        mont = ctx.to_montgomery(r);
+    }
+
+    // Installs a new modulus; values created under the previous one become meaningless.
+    static void set_mod(uint64_t m) {
+        ctx = MontgomeryContext(m);
+    }
+    static uint64_t mod() { return ctx.mod; }
+    uint64_t val() const { return ctx.from_montgomery(mont); }
+
+    DynModInt& operator+=(const DynModInt &other) {
+        mont += other.mont;
+        if(mont >= ctx.mod)
+            mont -= ctx.mod;
+        return *this;
+    }
+    DynModInt& operator-=(const DynModInt &other) {
+        mont = mont >= other.mont ? mont - other.mont : mont + ctx.mod - other.mont;
+        return *this;
+    }
+    DynModInt& operator*=(const DynModInt &other) {
+        mont = ctx.mul(mont, other.mont);
+        return *this;
+    }
+    // Fast exponentiation (binary exponentiation) modulo the current modulus.
+    DynModInt pow(unsigned long long exp) const {
+        DynModInt base = *this;
+        DynModInt result(1);
+        while(exp > 0) {
+            if(exp & 1)
+                result *= base;
+            base *= base;
+            exp >>= 1;
+        }
+        return result;
+    }
+    // Assuming the modulus is prime.
+    DynModInt inv() const {
+        PROFILE_SCOPE(ModInverse);
+        return pow(ctx.mod - 2);
+    }
+    DynModInt& operator/=(const DynModInt &other) {
+        *this *= other.inv();
+        return *this;
+    }
+    friend DynModInt operator+(DynModInt a, const DynModInt &b) { return a += b; }
+    friend DynModInt operator-(DynModInt a, const DynModInt &b) { return a -= b; }
+    friend DynModInt operator*(DynModInt a, const DynModInt &b) { return a *= b; }
+    friend DynModInt operator/(DynModInt a, const DynModInt &b) { return a /= b; }
+
+    friend ostream& operator<<(ostream &os, const DynModInt &m) {
+        os << m.val();
+        return os;
+    }
+    friend bool operator==(const DynModInt &a, const DynModInt &b) {
+        return a.mont == b.mont;
+    }
+    friend bool operator!=(const DynModInt &a, const DynModInt &b) {
+        return a.mont != b.mont;
+    }
+
+private:
+    static inline MontgomeryContext ctx{998244353};
+};
+
+// DynModInt product: schoolbook and Karatsuba for short operands, and an exact
+// multi-prime NTT with CRT back to the runtime modulus for long ones.
+template<int ID>
+vector<DynModInt<ID>> convolve(const vector<DynModInt<ID>>& a, const vector<DynModInt<ID>>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    size_t shorter = min(a.size(), b.size());
+    size_t need = a.size() + b.size() - 1;
+    if(shorter <= KARATSUBA_THRESHOLD) {
+        vector<DynModInt<ID>> res(need, DynModInt<ID>(0));
+        convolve_schoolbook_add(a.data(), a.size(), b.data(), b.size(), res.data());
+        return res;
+    }
+    if(shorter >= NTT_CRT_THRESHOLD && crt_supports(need, DynModInt<ID>::mod()))
+        return convolve_crt_modular(a, b);
+    return convolve_karatsuba(a, b);
+}
+
+//////////////////////////////
+// Primality
+//////////////////////////////
+
+// Deterministic Miller-Rabin for 64-bit integers.
+inline bool is_prime_u64(uint64_t n) {
+    if(n < 2)
+        return false;
+    for (uint64_t p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        if(n % p == 0)
+            return n == p;
+    }
+    uint64_t d = n - 1;
+    int s = 0;
+    while(d % 2 == 0) {
+        d /= 2;
+        s++;
+    }
+    auto mul_mod = [n](uint64_t a, uint64_t b) { return (uint64_t)((unsigned __int128)a * b % n); };
+    for (uint64_t a : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        uint64_t x = 1, base = a, e = d;
+        while(e > 0) {
+            if(e & 1)
+                x = mul_mod(x, base);
+            base = mul_mod(base, base);
+            e >>= 1;
+        }
+        if(x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; r++) {
+            x = mul_mod(x, x);
+            composite = x != n - 1;
+        }
+        if(composite)
+            return false;
+    }
+    return true;
+}
@@ -5,9 +5,21 @@
 #include <stdexcept>
 #include <tuple>
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <type_traits>
 #include "polynomial.h"
+#include "poly_gcd.h"
 #include "modint.h"
+#include "dynmodint.h"
+#include "gf2poly.h"
+#include "bigint.h"
+#include "result_cache.h"
 
 using namespace std;
 
@@ -16,93 +28,349 @@ using namespace std;
 // factor_ring.h
 //////////////////////////////
 
+// The Frobenius map a -> a^p is applied with the precomputed matrix for primes of at least
+// this many bits (smaller ones square and multiply) and moduli up to the given degree
+// (an n x n matrix; larger ones power). The matrix is built once a modulus has been asked
+// for enough maps to pay for it.
+inline constexpr int FROBENIUS_MATRIX_MIN_BITS = 8;
+inline constexpr int FROBENIUS_MATRIX_MAX_DEGREE = 2048;
+
+// base^e by left-to-right sliding windows over the nbits bits of e (bit(i) is bit i).
+// The window width grows with the exponent length; odd powers base^1, base^3, ... up to
+// the window size are precomputed, so an exponent of b bits costs about b squarings and
+// b / (w + 1) multiplications.
+template<typename E, typename Bit, typename Mul, typename Sqr>
+E sliding_window_pow(const E& one, const E& base, size_t nbits, Bit bit, Mul mul, Sqr sqr) {
+    if(nbits == 0)
+        return one;
+    int w = nbits > 671 ? 6 : nbits > 239 ? 5 : nbits > 79 ? 4 : nbits > 23 ? 3 : nbits > 6 ? 2 : 1;
+    vector<E> odd(1, base); // odd[i] = base^(2i + 1)
+    if(w > 1) {
+        E base_sq = sqr(base);
+        for (int i = 1; i < (1 << (w - 1)); i++)
+            odd.push_back(mul(odd.back(), base_sq));
+    }
+    E result = one;
+    bool started = false;
+    for (long i = (long)nbits - 1; i >= 0;) {
+        if(!bit(i)) {
+            if(started)
+                result = sqr(result);
+            i--;
+            continue;
+        }
+        // The longest window [j, i] of at most w bits that ends in a set bit.
+        long j = max(0L, i - w + 1);
+        while(!bit(j))
+            j++;
+        unsigned value = 0;
+        for (long k = i; k >= j; k--)
+            value = value * 2 + (bit(k) ? 1 : 0);
+        if(started) {
+            for (long k = i; k >= j; k--)
+                result = sqr(result);
+            result = mul(result, odd[value / 2]);
+        } else {
+            result = odd[value / 2];
+            started = true;
+        }
+        i = j - 1;
+    }
+    return result;
+}
+
+// Immutable data shared by every element of one factor ring R[x]/(mod_poly):
+// the modulus itself and the reciprocal of its reversal, precomputed once so that
+// reducing a product of two reduced elements costs two multiplications.
+// Rings over Z_2 instead keep a bit-packed copy of the modulus and do their
+// arithmetic on GF2Poly (gf2poly.h).
+template<typename T>
+class ModulusContext {
+public:
+    static constexpr bool PACKED = is_same_v<T, ModInt<2>>;
+
+    const Polynomial<T> mod_poly; // The modulus polynomial (the ideal).
+    const PackedModulus<T> packed;
+
+    explicit ModulusContext(const Polynomial<T>& mod_poly) : mod_poly(mod_poly), packed(mod_poly) {
+        if(mod_poly.degree() < 0)
+            throw runtime_error("Factor ring modulus must be nonzero");
+        int n = mod_poly.degree();
+        if(n > DIVISION_NEWTON_THRESHOLD && !PACKED)
+            rev_inv = mod_poly.reversed(n + 1).inverse_series(n - 1);
+    }
+
+    int degree() const {
+        return mod_poly.degree();
+    }
+
+    // Remainder of a modulo mod_poly.
+    Polynomial<T> reduce(const Polynomial<T>& a) const {
+        PROFILE_SCOPE(RingReduce);
+        int n = degree(), da = a.degree();
+        if(da < n)
+            return a;
+        if constexpr(PACKED)
+            return packed.ring.reduce(GF2Poly(a)).to_polynomial();
+        if(rev_inv.degree() < 0 || da > 2 * n - 2)
+            return a % mod_poly;
+        // Quotient from the precomputed reciprocal: rev(Q) = rev(A) / rev(f) mod x^k.
+        int k = da - n + 1;
+        Polynomial<T> rev_q = (a.reversed(da + 1).truncated(k) * rev_inv.truncated(k)).truncated(k);
+        Polynomial<T> q = rev_q.reversed(k);
+        return a.truncated(n) - (mod_poly * q).truncated(n);
+    }
+
+    // Over Z_p (T with a static mod()): x^p mod mod_poly, computed on first use.
+    const Polynomial<T>& frobenius_image() const {
+        call_once(frobenius_once, [this] {
+            Polynomial<T> x = reduce(Polynomial<T>(vector<T>{T(0), T(1)}));
+            unsigned long long p = (unsigned long long)T::mod();
+            auto mul = [this](const Polynomial<T>& a, const Polynomial<T>& b) { return reduce(a * b); };
+            auto sqr = [this](const Polynomial<T>& a) { return reduce(a * a); };
+            x_to_p = sliding_window_pow(reduce(Polynomial<T>(T(1))), x, bit_width(p),
+                                        [p](long i) { return (p >> i) & 1; }, mul, sqr);
+        });
+        return x_to_p;
+    }
+
+    // The matrix of the Z_p-linear map a -> a^p: column j holds x^(j p) mod mod_poly, so
+    // a^p = sum a_j x^(j p) (a_j^p = a_j in Z_p) costs one matrix-vector product.
+    // Built on first use with deg - 1 multiplications by x^p.
+    const vector<vector<T>>& frobenius_matrix() const {
+        const Polynomial<T>& xp = frobenius_image();
+        call_once(matrix_once, [this, &xp] {
+            int n = degree();
+            frobenius_columns.assign(n, vector<T>(n, T(0)));
+            Polynomial<T> col = reduce(Polynomial<T>(T(1)));
+            for (int j = 0; j < n; j++) {
+                copy(col.coeffs.begin(), col.coeffs.end(), frobenius_columns[j].begin());
+                if(j + 1 < n)
+                    col = reduce(col * xp);
+            }
+        });
+        return frobenius_columns;
+    }
+
+    // Counts a request for the Frobenius map and tells whether the matrix should be used:
+    // building it costs about deg multiplications and powering by p about 1.5 log2 p, so
+    // it is built once the requests so far would have paid for it.
+    bool frobenius_matrix_due() const {
+        long calls = ++frobenius_calls;
+        return 3 * calls * (long)bit_width((unsigned long long)T::mod()) >= 2L * degree();
+    }
+
+    // a^p for a reduced a, through the Frobenius matrix.
+    Polynomial<T> apply_frobenius(const Polynomial<T>& a) const {
+        const vector<vector<T>>& m = frobenius_matrix();
+        vector<T> res(degree(), T(0));
+        for (size_t j = 0; j < a.coeffs.size(); j++) {
+            if(a.coeffs[j] == T(0))
+                continue;
+            const T c = a.coeffs[j];
+            const vector<T>& col = m[j];
+            for (size_t i = 0; i < res.size(); i++)
+                res[i] = res[i] + c * col[i];
+        }
+        return Polynomial<T>(move(res));
+    }
+
+private:
+    Polynomial<T> rev_inv; // 1 / rev(mod_poly) mod x^(deg - 1); empty for small moduli.
+    mutable once_flag frobenius_once, matrix_once;
+    mutable atomic<long> frobenius_calls{0};
+    mutable Polynomial<T> x_to_p;
+    mutable vector<vector<T>> frobenius_columns;
+};
+
 // Template class representing an element of the factor ring R[x]/(mod_poly).
 // Internally, the element is stored as a polynomial reduced modulo mod_poly.
+// Elements of one ring point to a shared ModulusContext instead of copying the modulus.
 template<typename T>
 class FactorRingElement {
 public:
-    Polynomial<T> poly;     // The polynomial representing the element.
-    Polynomial<T> mod_poly; // The modulus polynomial (the ideal).
+    typedef shared_ptr<const ModulusContext<T>> Context;
 
+    Polynomial<T> poly; // The polynomial representing the element.
+    Context ctx;        // The ring this element belongs to.
+
+    FactorRingElement(const Polynomial<T>& poly, const Context& ctx)
+        : poly(ctx->reduce(poly)), ctx(ctx) {}
     FactorRingElement(const Polynomial<T>& poly, const Polynomial<T>& mod_poly)
-        : mod_poly(mod_poly)
-    {
-        this->poly = poly % mod_poly;
-    }
+        : FactorRingElement(poly, make_shared<const ModulusContext<T>>(mod_poly)) {}
     // Default constructor (unit element).
-    FactorRingElement() : mod_poly(Polynomial<T>(T(1))) {}
+    FactorRingElement() : FactorRingElement(Polynomial<T>(), Polynomial<T>(T(1))) {}
+
+    // The modulus polynomial (the ideal).
+    const Polynomial<T>& modulus() const {
+        return ctx->mod_poly;
+    }
 
     FactorRingElement operator+(const FactorRingElement& other) const {
-        if(mod_poly.coeffs != other.mod_poly.coeffs)
+        if(!same_ring(other))
             throw runtime_error("Different moduli in factor ring addition");
-        return FactorRingElement(poly + other.poly, mod_poly);
+        return from_reduced(poly + other.poly);
     }
     
     FactorRingElement operator-(const FactorRingElement& other) const {
-        if(mod_poly.coeffs != other.mod_poly.coeffs)
+        if(!same_ring(other))
             throw runtime_error("Different moduli in factor ring subtraction");
-        return FactorRingElement(poly - other.poly, mod_poly);
+        return from_reduced(poly - other.poly);
     }
     
     FactorRingElement operator*(const FactorRingElement& other) const {
-        if(mod_poly.coeffs != other.mod_poly.coeffs)
+        if(!same_ring(other))
             throw runtime_error("Different moduli in factor ring multiplication");
-        return FactorRingElement(poly * other.poly, mod_poly);
+        if constexpr(ModulusContext<T>::PACKED)
+            return from_reduced(ctx->packed.ring.mul(GF2Poly(poly), GF2Poly(other.poly)).to_polynomial());
+        return FactorRingElement(poly * other.poly, ctx);
     }
     
     // Extended Euclidean algorithm for polynomials:
     // finds x and y such that a*x + b*y == gcd(a, b)
+    // Iterative for small degrees and half-GCD for large ones (see poly_gcd.h),
+    // so the stack depth no longer grows with the degree.
     static tuple<Polynomial<T>, Polynomial<T>, Polynomial<T>> extended_gcd(
         const Polynomial<T>& a, const Polynomial<T>& b)
     {
-        if(b.degree() < 0) {
-            return {a, Polynomial<T>(T(1)), Polynomial<T>(T(0))};
-        }
-        auto [q, r] = a.divmod(b);
-        auto [g, x, y] = extended_gcd(b, r);
-        return {g, y, x - q * y};
+        PROFILE_SCOPE(RingExtendedGcd);
+        return poly_extended_gcd(a, b);
     }
     
     // Compute the inverse in the factor ring if it exists.
     // The inverse exists if gcd(poly, mod_poly) is a nonzero constant polynomial.
     FactorRingElement inv() const {
-        auto [g, x, y] = extended_gcd(poly, mod_poly);
+        auto [g, x, y] = extended_gcd(poly, modulus());
         if(g.degree() != 0)
             throw runtime_error("Inverse does not exist in this factor ring");
         T inv_g = g.coeffs[0].inv(); // Assuming that T provides an inv() method.
-        return FactorRingElement(x * Polynomial<T>(inv_g), mod_poly);
+        return FactorRingElement(x * Polynomial<T>(inv_g), ctx);
     }
     
     FactorRingElement operator/(const FactorRingElement& other) const {
-        if(mod_poly.coeffs != other.mod_poly.coeffs)
+        if(!same_ring(other))
             throw runtime_error("Different moduli in factor ring division");
         return *this * other.inv();
     }
     
-    FactorRingElement pow(unsigned int exponent) const {
-        FactorRingElement result(Polynomial<T>(T(1)), mod_poly);
-        FactorRingElement base = *this;
-        while(exponent) {
-            if(exponent & 1)
-                result = result * base;
-            base = base * base;
-            exponent >>= 1;
+    FactorRingElement pow(unsigned long long exponent) const {
+        return pow_bits(bit_width(exponent), [exponent](long i) { return (exponent >> i) & 1; });
+    }
+    // Exponents of any size; a negative one raises the inverse.
+    FactorRingElement pow(const BigInt& exponent) const {
+        if(exponent.negative)
+            return inv().pow(-exponent);
+        const vector<uint32_t>& e = exponent.mag;
+        return pow_bits(exponent.bit_length(), [&e](long i) { return (e[i / 32] >> (i % 32)) & 1; });
+    }
+
+    // The Frobenius map a -> a^p over Z_p: one product with the modulus's Frobenius
+    // matrix where that pays off, otherwise a power. (a^p is also a(x^p), i.e.
+    // compose(x^p); the matrix is that composition precomputed.)
+    FactorRingElement frobenius() const {
+        unsigned long long p = (unsigned long long)T::mod();
+        if(bit_width(p) >= FROBENIUS_MATRIX_MIN_BITS && ctx->degree() <= FROBENIUS_MATRIX_MAX_DEGREE
+           && ctx->frobenius_matrix_due())
+            return from_reduced(ctx->apply_frobenius(poly));
+        return pow(p);
+    }
+
+    // f(a) for this element a (modular composition), by Brent-Kung baby steps and giant
+    // steps: with m = ceil(sqrt(deg f + 1)), the powers a^0 .. a^m are computed once, every
+    // block of m coefficients of f is combined with them (a (blocks x m) by (m x deg)
+    // matrix product), and the blocks are joined by Horner's rule in a^m. This costs about
+    // 2 sqrt(deg f) ring multiplications instead of deg f.
+    FactorRingElement compose(const Polynomial<T>& f) const {
+        int k = f.degree();
+        if(k < 0)
+            return from_reduced(Polynomial<T>());
+        int m = (int)ceil(sqrt((double)k + 1));
+        vector<FactorRingElement> baby(1, FactorRingElement(Polynomial<T>(T(1)), ctx));
+        for (int j = 1; j <= m; j++)
+            baby.push_back(baby.back() * *this);
+        int blocks = (k + m) / m, n = max(1, ctx->degree());
+        FactorRingElement result = from_reduced(Polynomial<T>());
+        for (int b = blocks - 1; b >= 0; b--) {
+            vector<T> block(n, T(0));
+            for (int j = 0; j < m && b * m + j <= k; j++) {
+                T c = f.coeffs[b * m + j];
+                if(c == T(0))
+                    continue;
+                const vector<T>& pc = baby[j].poly.coeffs;
+                for (size_t t = 0; t < pc.size(); t++)
+                    block[t] = block[t] + c * pc[t];
+            }
+            result = (b == blocks - 1 ? result : result * baby[m]) + from_reduced(Polynomial<T>(move(block)));
         }
         return result;
     }
+
+    // Trace and norm down to Z_p in the field Z_p[x]/(f), f irreducible of degree n: the
+    // sum and the product of the conjugates a, a^p, ..., a^(p^(n-1)).
+    T trace() const {
+        FactorRingElement conj = *this, sum = *this;
+        for (int i = 1; i < ctx->degree(); i++) {
+            conj = conj.frobenius();
+            sum = sum + conj;
+        }
+        return sum.poly[0];
+    }
+    T norm() const {
+        FactorRingElement conj = *this, prod = *this;
+        for (int i = 1; i < ctx->degree(); i++) {
+            conj = conj.frobenius();
+            prod = prod * conj;
+        }
+        return prod.poly[0];
+    }
     
     friend ostream& operator<<(ostream &os, const FactorRingElement& elem) {
         os << elem.poly;
         return os;
     }
+
+private:
+    // Elements sharing a context compare by pointer; separately built contexts fall back
+    // to comparing the moduli.
+    bool same_ring(const FactorRingElement& other) const {
+        return ctx == other.ctx || ctx->mod_poly.coeffs == other.ctx->mod_poly.coeffs;
+    }
+
+    // Sliding-window power; rings over Z_2 pack the operands once for the whole power.
+    template<typename Bit>
+    FactorRingElement pow_bits(size_t nbits, Bit bit) const {
+        if constexpr(ModulusContext<T>::PACKED) {
+            const GF2Modulus& ring = ctx->packed.ring;
+            GF2Poly r = sliding_window_pow(ring.reduce(GF2Poly::monomial(0)), GF2Poly(poly), nbits, bit,
+                                           [&ring](const GF2Poly& a, const GF2Poly& b) { return ring.mul(a, b); },
+                                           [&ring](const GF2Poly& a) { return ring.square(a); });
+            return from_reduced(r.to_polynomial());
+        } else {
+            return sliding_window_pow(FactorRingElement(Polynomial<T>(T(1)), ctx), *this, nbits, bit,
+                                      [](const FactorRingElement& a, const FactorRingElement& b) { return a * b; },
+                                      [](const FactorRingElement& a) { return a * a; });
+        }
+    }
+
+    // Wraps a polynomial that is already reduced (sums and differences of elements).
+    FactorRingElement from_reduced(const Polynomial<T>& reduced) const {
+        FactorRingElement result(Polynomial<T>(), ctx);
+        result.poly = reduced;
+        return result;
+    }
 };
 
 //////////////////////////////
 // Irreducibility Check
 //////////////////////////////
 
-// A simple brute-force irreducibility check over a finite field F (with coefficients of type T).
-// This function assumes that T (for example, ModInt<...>) provides a static constant MOD_VALUE.
+// Ben-Or irreducibility test over a finite field F = Z_p (with coefficients of type T).
+// A polynomial f of degree n is irreducible iff gcd(x^(p^i) - x, f) = 1 for i = 1 .. n/2,
+// since x^(p^i) - x is the product of all monic irreducibles whose degree divides i.
+// The Frobenius powers x^(p^i) mod f are built one from the next by the Frobenius map
+// (one matrix-vector product for larger p), so the test is polynomial in n and log p.
+// Reducible inputs usually fail within a few steps.
+// This function assumes that T (for example, ModInt<...> or DynModInt<...>) provides a static mod().
 template<typename T>
 bool is_irreducible(const Polynomial<T>& poly) {
     int deg = poly.degree();
@@ -110,34 +378,39 @@ bool is_irreducible(const Polynomial<T>& poly) {
         return false;
     if(deg == 1)
         return true;
-    int field_mod = T::MOD_VALUE;
-    // Check for any nontrivial factor (of degree from 1 up to deg/2).
-    for (int d = 1; d <= deg / 2; d++) {
-        vector<T> coeffs(d, T(0));
-        // Use a recursive lambda to generate all monic candidate divisors of degree d.
-        function<bool(int)> gen = [&](int pos) -> bool {
-            if (pos == d) {
-                vector<T> candidate_coeffs = coeffs;
-                candidate_coeffs.push_back(T(1)); // force monic coefficient
-                Polynomial<T> candidate(candidate_coeffs);
-                auto rem = poly.divmod(candidate).second;
-                if(rem.degree() < 0)
-                    return true; // candidate divides poly exactly -> poly is reducible.
-                return false;
-            }
-            for (int i = 0; i < field_mod; i++) {
-                coeffs[pos] = T(i);
-                if (gen(pos + 1))
-                    return true;
-            }
+    if constexpr(is_same_v<T, ModInt<2>>)
+        return gf2_is_irreducible(GF2Poly(poly));
+    Polynomial<T> f = make_monic(poly);
+    auto ring = make_shared<const ModulusContext<T>>(f);
+    FactorRingElement<T> x(Polynomial<T>(vector<T>{T(0), T(1)}), ring);
+    FactorRingElement<T> frobenius = x;
+    for (int i = 1; i <= deg / 2; i++) {
+        frobenius = frobenius.frobenius(); // x^(p^i) mod f
+        if(poly_gcd(f, (frobenius - x).poly).degree() > 0)
             return false;
-        };
-        if(gen(0))
-            return false; // found a divisor, so poly is reducible.
     }
     return true;
 }
 
+// Draws random monic polynomials of the given degree until one is irreducible.
+// About one in every `degree` candidates is irreducible, and most reducible candidates
+// are rejected by the first gcd step of is_irreducible.
+template<typename T, typename RNG>
+Polynomial<T> random_irreducible(int degree, RNG& rng) {
+    if(degree < 1)
+        throw invalid_argument("Irreducible polynomials have degree at least 1");
+    uniform_int_distribution<unsigned long long> coeff(0, (unsigned long long)T::mod() - 1);
+    vector<T> c(degree + 1);
+    while(true) {
+        for (int i = 0; i < degree; i++)
+            c[i] = T((long long)coeff(rng));
+        c[degree] = T(1);
+        Polynomial<T> candidate(c);
+        if(is_irreducible(candidate))
+            return candidate;
+    }
+}
+
 //////////////////////////////
 // Helper function to read a polynomial from input.
 //////////////////////////////
@@ -152,7 +425,7 @@ Polynomial<T> read_polynomial() {
     vector<T> coeff(n);
     cout << "Enter the coefficients (constant term first): ";
     for (int i = 0; i < n; i++) {
-        int tmp;
+        long long tmp;
         cin >> tmp;
         coeff[i] = T(tmp);
     }
@@ -163,19 +436,21 @@ Polynomial<T> read_polynomial() {
 // Factor Ring Operations (Field Extension F[x]/(f(x)))
 //////////////////////////////
 
-// Sets up the factor ring F[x]/(f(x)) over a given prime field F = Z_p.
+// Sets up the factor ring F[x]/(f(x)) over a given prime field F = Z_p, where Field is
+// ModInt<p> or a DynModInt whose modulus has been set to p.
 // The user is prompted for an irreducible polynomial f(x) over F and then for two elements.
 // Operations like addition, subtraction, multiplication, inversion, division and exponentiation are performed.
-template<int P>
+template<typename Field>
 void run_factor_ring() {
-    typedef ModInt<P> Field;
+    const auto P = Field::mod();
+    RingCache<Field>& cache = RingCache<Field>::shared();
     cout << "\nFactor ring operations over field Z" << P << ":\n";
     Polynomial<Field> f;
     bool irreducible_valid = false;
     while(!irreducible_valid) {
         cout << "Enter the polynomial f(x) (coefficients as constant term first):\n";
         f = read_polynomial<Field>();
-        if(is_irreducible(f)) {
+        if(cache.is_irreducible(f)) {
             irreducible_valid = true;
         } else {
             cout << "The polynomial f(x) is reducible over Z" << P
@@ -187,8 +462,9 @@ void run_factor_ring() {
     Polynomial<Field> a = read_polynomial<Field>();
     cout << "Enter the second element:\n";
     Polynomial<Field> b = read_polynomial<Field>();
-    FactorRingElement<Field> elem1(a, f);
-    FactorRingElement<Field> elem2(b, f);
+    auto ring = cache.context(f);
+    FactorRingElement<Field> elem1(a, ring);
+    FactorRingElement<Field> elem2(b, ring);
     
     cout << "Element A = " << elem1 << "\n";
     cout << "Element B = " << elem2 << "\n";
@@ -196,15 +472,20 @@ void run_factor_ring() {
     cout << "\nA + B = " << (elem1 + elem2) << "\n";
     cout << "A - B = " << (elem1 - elem2) << "\n";
     cout << "A * B = " << (elem1 * elem2) << "\n";
+    cout << "Tr(A) = " << elem1.trace() << ", N(A) = " << elem1.norm() << "\n";
     try {
-        FactorRingElement<Field> invA = elem1.inv();
+        FactorRingElement<Field> invA = cache.inverse(elem1);
         cout << "Inverse of A = " << invA << "\n";
         cout << "A / B = " << (elem1 / elem2) << "\n";
     } catch(const runtime_error& e) {
         cout << "Error computing inverse: " << e.what() << "\n";
     }
-    int exp;
+    BigInt exp;
     cout << "Enter an exponent for computing A^exp: ";
     cin >> exp;
-    cout << "A^" << exp << " = " << elem1.pow(exp) << "\n";
+    try {
+        cout << "A^" << exp << " = " << elem1.pow(exp) << "\n";
+    } catch(const runtime_error& e) {
+        cout << "Error: " << e.what() << "\n";
+    }
 }
\ No newline at end of file
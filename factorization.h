@@ -0,0 +1,329 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <tuple>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <optional>
+#include "polynomial.h"
+#include "factor_ring.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+//////////////////////////////
+// factorization.h
+//////////////////////////////
+
+// Factorization of polynomials over a prime field F = Z_p (T = ModInt<p> or DynModInt).
+// The pipeline is square-free decomposition, distinct-degree factorization and
+// Cantor-Zassenhaus equal-degree splitting. For small p, Berlekamp's algorithm can
+// replace the last two stages.
+
+enum class FactorMethod { Auto, CantorZassenhaus, Berlekamp };
+
+// FactorMethod::Auto uses Berlekamp for fields up to this size (it tries every s in F_p).
+inline constexpr unsigned long long BERLEKAMP_MAX_P = 16;
+// Independent splitting tasks at least this large run as tasks on the shared thread pool.
+inline constexpr int FACTOR_PARALLEL_MIN_DEGREE = 32;
+
+template<typename T>
+struct Factorization {
+    T unit;                                   // The leading coefficient.
+    vector<pair<Polynomial<T>, int>> factors; // Monic irreducible factors with multiplicities.
+};
+
+// The polynomial g with g^p = f, for f whose exponents are all multiples of p.
+// Elements of F_p are their own p-th roots, so only the exponents change.
+template<typename T>
+Polynomial<T> pth_root(const Polynomial<T>& f) {
+    size_t p = (size_t)T::mod();
+    vector<T> c(f.coeffs.size() / p + 1, T(0));
+    for (size_t i = 0; i < f.coeffs.size(); i += p)
+        c[i / p] = f.coeffs[i];
+    return Polynomial<T>(c);
+}
+
+// Appends the square-free parts of the monic polynomial f: pairs (s_i, i * multiplier)
+// with f = prod s_i^i and every s_i square-free and pairwise coprime.
+template<typename T>
+void square_free_decomposition(const Polynomial<T>& f, int multiplier,
+                               vector<pair<Polynomial<T>, int>>& out) {
+    Polynomial<T> c = poly_gcd(f, derivative(f));
+    Polynomial<T> w = f / c;
+    for (int i = 1; w.degree() > 0; i++) {
+        Polynomial<T> y = poly_gcd(w, c);
+        Polynomial<T> part = w / y;
+        if(part.degree() > 0)
+            out.push_back({make_monic(part), i * multiplier});
+        w = y;
+        c = c / y;
+    }
+    // What is left is a p-th power (its derivative vanishes).
+    if(c.degree() > 0)
+        square_free_decomposition(make_monic(pth_root(c)), multiplier * (int)T::mod(), out);
+}
+
+// Splits a monic square-free f into pairs (g_d, d), where g_d is the product of all
+// irreducible factors of degree d, using gcd(x^(p^d) - x, f).
+template<typename T>
+vector<pair<Polynomial<T>, int>> distinct_degree_factorization(const Polynomial<T>& f) {
+    vector<pair<Polynomial<T>, int>> out;
+    Polynomial<T> rest = f;
+    Polynomial<T> x(vector<T>{T(0), T(1)});
+    auto ring = make_shared<const ModulusContext<T>>(rest);
+    FactorRingElement<T> frobenius(x, ring);
+    for (int d = 1; 2 * d <= rest.degree(); d++) {
+        frobenius = frobenius.frobenius(); // x^(p^d) mod rest
+        Polynomial<T> g = poly_gcd(rest, (frobenius - FactorRingElement<T>(x, ring)).poly);
+        if(g.degree() > 0) {
+            out.push_back({g, d});
+            rest = rest / g;
+            ring = make_shared<const ModulusContext<T>>(rest);
+            frobenius = FactorRingElement<T>(frobenius.poly, ring);
+        }
+    }
+    if(rest.degree() > 0)
+        out.push_back({rest, rest.degree()});
+    return out;
+}
+
+// Finds a nontrivial monic factor of f (monic, square-free, all factors of degree d < deg f).
+// A random a splits f through gcd(a^((p^d - 1) / 2) - 1, f), or through the trace
+// a + a^2 + ... + a^(2^(d-1)) when p = 2; each attempt succeeds with probability about 1/2.
+template<typename T, typename RNG>
+Polynomial<T> equal_degree_split(const Polynomial<T>& f, int d, RNG& rng) {
+    int n = f.degree();
+    unsigned long long p = (unsigned long long)T::mod();
+    auto ring = make_shared<const ModulusContext<T>>(f);
+    uniform_int_distribution<unsigned long long> coeff(0, p - 1);
+    FactorRingElement<T> one(Polynomial<T>(T(1)), ring);
+    while(true) {
+        vector<T> c(n);
+        for (auto &v : c)
+            v = T((long long)coeff(rng));
+        Polynomial<T> a(c);
+        if(a.degree() <= 0)
+            continue;
+        Polynomial<T> g = poly_gcd(f, a);
+        if(g.degree() > 0)
+            return g;
+        FactorRingElement<T> elem(a, ring);
+        FactorRingElement<T> b;
+        if(p == 2) {
+            b = elem;
+            FactorRingElement<T> square = elem;
+            for (int j = 1; j < d; j++) {
+                square = square * square;
+                b = b + square;
+            }
+        } else {
+            // elem^(1 + p + ... + p^(d-1)), then the power (p - 1) / 2.
+            FactorRingElement<T> t = elem;
+            for (int j = 1; j < d; j++)
+                t = t.frobenius() * elem;
+            b = t.pow((p - 1) / 2) - one;
+        }
+        g = poly_gcd(f, b.poly);
+        if(g.degree() > 0 && g.degree() < n)
+            return g;
+    }
+}
+
+// All irreducible factors of f (monic, square-free, every factor of degree d).
+// The two halves of each split are independent and large ones run in parallel.
+template<typename T>
+vector<Polynomial<T>> equal_degree_factorization(const Polynomial<T>& f, int d, unsigned long long seed) {
+    if(f.degree() <= d)
+        return {f};
+    mt19937_64 rng(seed);
+    Polynomial<T> g = equal_degree_split(f, d, rng);
+    Polynomial<T> h = make_monic(f / g);
+    unsigned long long seed_g = rng(), seed_h = rng();
+    vector<Polynomial<T>> left, result;
+    auto split_g = [&] { left = equal_degree_factorization(g, d, seed_g); };
+    auto split_h = [&] { result = equal_degree_factorization(h, d, seed_h); };
+    if(parallel_worthwhile(f.degree(), FACTOR_PARALLEL_MIN_DEGREE)) {
+        parallel_invoke(split_g, split_h);
+    } else {
+        split_g();
+        split_h();
+    }
+    result.insert(result.end(), left.begin(), left.end());
+    return result;
+}
+
+// Basis of the null space { v : a v = 0 } of a matrix over a field.
+template<typename T>
+vector<vector<T>> null_space(vector<vector<T>> a) {
+    int rows = a.size(), cols = rows ? a[0].size() : 0;
+    vector<int> pivot_row(cols, -1);
+    int r = 0;
+    for (int c = 0; c < cols && r < rows; c++) {
+        int sel = r;
+        while(sel < rows && a[sel][c] == T(0))
+            sel++;
+        if(sel == rows)
+            continue;
+        swap(a[sel], a[r]);
+        T inv = T(1) / a[r][c];
+        for (int j = c; j < cols; j++)
+            a[r][j] = a[r][j] * inv;
+        for (int i = 0; i < rows; i++) {
+            if(i == r || a[i][c] == T(0))
+                continue;
+            T factor = a[i][c];
+            for (int j = c; j < cols; j++)
+                a[i][j] = a[i][j] - factor * a[r][j];
+        }
+        pivot_row[c] = r++;
+    }
+    vector<vector<T>> basis;
+    for (int free_col = 0; free_col < cols; free_col++) {
+        if(pivot_row[free_col] >= 0)
+            continue;
+        vector<T> v(cols, T(0));
+        v[free_col] = T(1);
+        for (int c = 0; c < cols; c++)
+            if(pivot_row[c] >= 0)
+                v[c] = T(0) - a[pivot_row[c]][free_col];
+        basis.push_back(v);
+    }
+    return basis;
+}
+
+// Berlekamp's algorithm for a monic square-free f. The polynomials g with g^p = g mod f
+// form a subspace (the kernel of Q - I, Q being the matrix of the Frobenius map) whose
+// dimension is the number of irreducible factors; gcd(u, g - s) over s in F_p splits them.
+template<typename T>
+vector<Polynomial<T>> berlekamp(const Polynomial<T>& f) {
+    int n = f.degree();
+    if(n <= 1)
+        return {f};
+    unsigned long long p = (unsigned long long)T::mod();
+    auto ring = make_shared<const ModulusContext<T>>(f);
+    FactorRingElement<T> xp = FactorRingElement<T>(Polynomial<T>(vector<T>{T(0), T(1)}), ring).pow(p);
+    FactorRingElement<T> row(Polynomial<T>(T(1)), ring);
+    // a = (Q - I)^T, where row i of Q holds x^(i p) mod f.
+    vector<vector<T>> a(n, vector<T>(n, T(0)));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++)
+            a[j][i] = row.poly[j] - (i == j ? T(1) : T(0));
+        row = row * xp;
+    }
+    vector<vector<T>> basis = null_space(a);
+    vector<Polynomial<T>> factors = {f};
+    for (auto &v : basis) {
+        if(factors.size() == basis.size())
+            break;
+        Polynomial<T> g(v);
+        if(g.degree() <= 0)
+            continue;
+        vector<Polynomial<T>> next;
+        for (auto &u : factors) {
+            if(u.degree() == 1) {
+                next.push_back(u);
+                continue;
+            }
+            for (unsigned long long s = 0; s < p; s++) {
+                Polynomial<T> h = poly_gcd(u, g - Polynomial<T>(T((long long)s)));
+                if(h.degree() > 0)
+                    next.push_back(h);
+            }
+        }
+        factors = next;
+    }
+    return factors;
+}
+
+// Complete factorization f = unit * prod factor^multiplicity over F_p.
+// Every square-free part (and, for Cantor-Zassenhaus, every distinct-degree block) is
+// split as an independent task; large tasks run in parallel.
+template<typename T>
+Factorization<T> factor(const Polynomial<T>& f, FactorMethod method = FactorMethod::Auto,
+                        unsigned long long seed = 0x9e3779b97f4a7c15ULL) {
+    if(f.degree() < 0)
+        throw runtime_error("Cannot factor the zero polynomial");
+    Factorization<T> result;
+    result.unit = f.coeffs.back();
+    vector<pair<Polynomial<T>, int>> parts;
+    square_free_decomposition(make_monic(f), 1, parts);
+    bool use_berlekamp = method == FactorMethod::Berlekamp ||
+        (method == FactorMethod::Auto && (unsigned long long)T::mod() <= BERLEKAMP_MAX_P);
+    mt19937_64 rng(seed);
+    // One task per polynomial to split; d = 0 marks a Berlekamp task.
+    struct Task {
+        Polynomial<T> poly;
+        int d, multiplicity;
+        unsigned long long seed;
+    };
+    vector<Task> tasks;
+    for (auto &[part, multiplicity] : parts) {
+        if(use_berlekamp) {
+            tasks.push_back({part, 0, multiplicity, 0});
+            continue;
+        }
+        for (auto &[block, d] : distinct_degree_factorization(part))
+            tasks.push_back({block, d, multiplicity, rng()});
+    }
+    vector<vector<Polynomial<T>>> split(tasks.size());
+    optional<TaskGroup> group; // created for the first large task, so small inputs never start the pool
+    for (size_t i = 0; i < tasks.size(); i++) {
+        auto run = [&tasks, &split, i] {
+            const Task& t = tasks[i];
+            split[i] = t.d == 0 ? berlekamp(t.poly) : equal_degree_factorization(t.poly, t.d, t.seed);
+        };
+        if(parallel_worthwhile(tasks[i].poly.degree(), FACTOR_PARALLEL_MIN_DEGREE)) {
+            if(!group)
+                group.emplace(ThreadPool::shared());
+            group->run(run);
+        } else {
+            run();
+        }
+    }
+    if(group)
+        group->wait();
+    for (size_t i = 0; i < tasks.size(); i++)
+        for (auto &factor : split[i])
+            result.factors.push_back({factor, tasks[i].multiplicity});
+    // Deterministic order: by degree, then by coefficients from the top.
+    sort(result.factors.begin(), result.factors.end(), [](const auto &x, const auto &y) {
+        const auto &a = x.first.coeffs, &b = y.first.coeffs;
+        if(a.size() != b.size())
+            return a.size() < b.size();
+        for (size_t i = a.size(); i-- > 0; )
+            if(a[i] != b[i])
+                return a[i].val() < b[i].val();
+        return false;
+    });
+    return result;
+}
+
+//////////////////////////////
+// Factorization over F = Z_p
+//////////////////////////////
+
+// Prompts for a polynomial over Field (ModInt<p> or a DynModInt set to p) and prints
+// its factorization.
+template<typename Field>
+void run_factorization() {
+    const auto P = Field::mod();
+    cout << "\nFactorization over field Z" << P << ":\n";
+    cout << "Enter the polynomial f(x):\n";
+    Polynomial<Field> f = read_polynomial<Field>();
+    if(f.degree() < 0) {
+        cout << "Cannot factor the zero polynomial.\n";
+        return;
+    }
+    Factorization<Field> result = factor(f);
+    cout << "f(x) = " << result.unit;
+    for (auto &[factor, multiplicity] : result.factors) {
+        cout << " * (" << factor << ")";
+        if(multiplicity > 1)
+            cout << "^" << multiplicity;
+    }
+    cout << "\n";
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <complex>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include "convolution.h"
+
+using namespace std;
+
+//////////////////////////////
+// fft.h
+//////////////////////////////
+
+// Complex FFT multiplication for real (double) coefficient vectors.
+// Two real sequences are packed into one complex transform (as real and imaginary
+// parts), so a balanced product costs two transforms instead of three. When one operand
+// is much longer, it is cut into blocks that are multiplied against the transform of the
+// short operand and overlap-added, two blocks per complex transform.
+// The rounding error of an FFT product is global: it scales with the norms of the whole
+// operands, so small coefficients next to large ones can be lost. fft_error_bound()
+// estimates it, and convolve() falls back to the schoolbook product when the estimate
+// would swamp the smallest coefficient products and the schoolbook product is affordable.
+// Otherwise convolve(a, b, &bound) reports the estimate with the product.
+
+// Below this operand length Karatsuba beats the transform.
+inline constexpr size_t FFT_THRESHOLD = 256;
+// Operands whose lengths differ by more than this factor use overlap-add blocks.
+inline constexpr size_t FFT_SPLIT_RATIO = 8;
+// The FFT product is trusted when its error bound is below this fraction of the
+// smallest nonzero coefficient product.
+inline constexpr double FFT_RELATIVE_TOLERANCE = 1e-4;
+// Largest schoolbook product (n * m multiply-adds) convolve() will fall back to.
+inline constexpr double FFT_FALLBACK_MAX_WORK = 1 << 26;
+
+// Twiddle factors exp(2 pi i j / len) for j < len / 2, computed once per power of two
+// directly from cos/sin (no accumulated rounding) and shared by all transforms.
+inline const complex<double>* fft_twiddles(int log_len) {
+    static mutex lock;
+    static vector<unique_ptr<vector<complex<double>>>> tables;
+    lock_guard<mutex> guard(lock);
+    if((int)tables.size() <= log_len)
+        tables.resize(log_len + 1);
+    if(!tables[log_len]) {
+        size_t len = (size_t)1 << log_len;
+        auto table = make_unique<vector<complex<double>>>(max<size_t>(1, len / 2));
+        const double angle = 2 * acos(-1.0) / (double)len;
+        for (size_t j = 0; j < len / 2; j++)
+            (*table)[j] = polar(1.0, angle * (double)j);
+        tables[log_len] = move(table);
+    }
+    return tables[log_len]->data();
+}
+
+// In-place transform of a power-of-two length vector (inverse transform if invert is set;
+// the inverse includes the 1/n scaling).
+inline void fft(vector<complex<double>>& a, bool invert) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            swap(a[i], a[j]);
+    }
+    if(invert)
+        for (auto &x : a)
+            x = conj(x);
+    for (int log_len = 1; ((size_t)1 << log_len) <= n; log_len++) {
+        size_t len = (size_t)1 << log_len, half = len / 2;
+        const complex<double>* w = fft_twiddles(log_len);
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < half; j++) {
+                complex<double> u = a[i+j];
+                complex<double> v = a[i+j+half] * w[j];
+                a[i+j] = u + v;
+                a[i+j+half] = u - v;
+            }
+        }
+    }
+    if(invert) {
+        double scale = 1.0 / (double)n;
+        for (auto &x : a)
+            x = conj(x) * scale;
+    }
+}
+
+inline int fft_log_size(size_t n) {
+    int log = 0;
+    while(((size_t)1 << log) < n)
+        log++;
+    return log;
+}
+
+// Estimated bound on the absolute error of any coefficient of the FFT product:
+// ||a||_2 * ||b||_2 * eps * O(log N) for a transform of length N.
+inline double fft_error_bound(const vector<double>& a, const vector<double>& b) {
+    double na = 0, nb = 0;
+    for (double x : a)
+        na += x * x;
+    for (double x : b)
+        nb += x * x;
+    int log_n = fft_log_size(a.size() + b.size());
+    return sqrt(na) * sqrt(nb) * numeric_limits<double>::epsilon() * (3.0 * log_n + 8.0);
+}
+
+// Balanced product: a + i b in one transform, then A_k B_k recovered from the
+// conjugate-symmetric parts.
+inline vector<double> convolve_fft_packed(const vector<double>& a, const vector<double>& b) {
+    size_t need = a.size() + b.size() - 1;
+    size_t n = (size_t)1 << fft_log_size(need);
+    vector<complex<double>> p(n);
+    for (size_t i = 0; i < a.size(); i++)
+        p[i].real(a[i]);
+    if(&a == &b) {
+        fft(p, false);
+        for (auto &x : p)
+            x *= x;
+    } else {
+        for (size_t i = 0; i < b.size(); i++)
+            p[i].imag(b[i]);
+        fft(p, false);
+        vector<complex<double>> c(n);
+        for (size_t k = 0; k < n; k++) {
+            size_t j = (n - k) & (n - 1);
+            complex<double> fa = (p[k] + conj(p[j])) * 0.5;
+            complex<double> fb = (p[k] - conj(p[j])) * complex<double>(0, -0.5);
+            c[k] = fa * fb;
+        }
+        p.swap(c);
+    }
+    fft(p, true);
+    vector<double> res(need);
+    for (size_t i = 0; i < need; i++)
+        res[i] = p[i].real();
+    return res;
+}
+
+// Unbalanced product (a much longer than b): blocks of a are multiplied by the cached
+// transform of b and overlap-added; each complex transform carries two real blocks.
+inline vector<double> convolve_fft_blocks(const vector<double>& a, const vector<double>& b) {
+    size_t m = b.size();
+    size_t n = (size_t)1 << fft_log_size(2 * m);
+    size_t block = n - m + 1;
+    vector<complex<double>> fb(n);
+    for (size_t i = 0; i < m; i++)
+        fb[i] = b[i];
+    fft(fb, false);
+    vector<double> res(a.size() + m - 1, 0.0);
+    vector<complex<double>> p(n);
+    for (size_t s = 0; s < a.size(); s += 2 * block) {
+        size_t s2 = s + block;
+        fill(p.begin(), p.end(), complex<double>(0, 0));
+        for (size_t i = s; i < min(s + block, a.size()); i++)
+            p[i - s].real(a[i]);
+        for (size_t i = s2; i < min(s2 + block, a.size()); i++)
+            p[i - s2].imag(a[i]);
+        fft(p, false);
+        for (size_t k = 0; k < n; k++)
+            p[k] *= fb[k];
+        fft(p, true);
+        size_t len1 = min(s + block, a.size()) - s + m - 1;
+        for (size_t i = 0; i < len1; i++)
+            res[s + i] += p[i].real();
+        if(s2 < a.size()) {
+            size_t len2 = min(s2 + block, a.size()) - s2 + m - 1;
+            for (size_t i = 0; i < len2; i++)
+                res[s2 + i] += p[i].imag();
+        }
+    }
+    return res;
+}
+
+// FFT product of real vectors. If error_bound is given, it receives fft_error_bound(a, b).
+inline vector<double> convolve_fft(const vector<double>& a, const vector<double>& b,
+                                   double* error_bound = nullptr) {
+    if(a.empty() || b.empty())
+        return {};
+    if(error_bound)
+        *error_bound = fft_error_bound(a, b);
+    if(a.size() >= FFT_SPLIT_RATIO * b.size())
+        return convolve_fft_blocks(a, b);
+    if(b.size() >= FFT_SPLIT_RATIO * a.size())
+        return convolve_fft_blocks(b, a);
+    return convolve_fft_packed(a, b);
+}
+
+// Smallest nonzero absolute value (infinity if all are zero).
+inline double min_nonzero_magnitude(const vector<double>& a) {
+    double m = numeric_limits<double>::infinity();
+    for (double x : a)
+        if(x != 0)
+            m = min(m, fabs(x));
+    return m;
+}
+
+// double product: schoolbook for short operands, Karatsuba or FFT for long ones.
+// Karatsuba's subtractions lose small terms in the same way as the transform, so both
+// fall back to the schoolbook product when the error bound would hide the smallest terms.
+// A product too large for that fallback is still computed by Karatsuba or the transform.
+// If error_bound is given, it receives the bound on the absolute error of every
+// coefficient of the result: fft_error_bound(a, b) for Karatsuba and FFT products, 0 for
+// the schoolbook product, which rounds every coefficient on its own.
+inline vector<double> convolve(const vector<double>& a, const vector<double>& b, double* error_bound) {
+    if(error_bound)
+        *error_bound = 0;
+    if(a.empty() || b.empty())
+        return {};
+    size_t shorter = min(a.size(), b.size());
+    if(shorter > KARATSUBA_THRESHOLD) {
+        double bound = fft_error_bound(a, b);
+        double work = (double)a.size() * (double)b.size();
+        bool reliable = bound <= FFT_RELATIVE_TOLERANCE * min_nonzero_magnitude(a) * min_nonzero_magnitude(b);
+        if(reliable || work > FFT_FALLBACK_MAX_WORK) {
+            if(error_bound)
+                *error_bound = bound;
+            if(shorter < FFT_THRESHOLD)
+                return convolve_karatsuba(a, b);
+            return &a == &b ? convolve_fft(a, a) : convolve_fft(a, b);
+        }
+    }
+    vector<double> res(a.size() + b.size() - 1, 0.0);
+    convolve_schoolbook_add(a.data(), a.size(), b.data(), b.size(), res.data());
+    return res;
+}
+
+inline vector<double> convolve(const vector<double>& a, const vector<double>& b) {
+    return convolve(a, b, nullptr);
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+//////////////////////////////
+// galois_field.h
+//////////////////////////////
+
+// Elements of a fixed finite field GF(P^N) = Z_P[a]/(m(a)), with P prime and the monic
+// modulus m(a) = a^N + Modulus[N-1] a^(N-1) + ... + Modulus[0] known at compile time.
+// An element is its N coefficients in a std::array (constant term first): no heap, no
+// context pointer, trivially copyable, so arrays of elements can be memcpy'd and written
+// as they are. Arithmetic is constexpr.
+//
+// Fields of at most GF_TABLE_MAX_ORDER elements multiply, divide and invert through
+// discrete log/antilog tables, built on first use: a * b = exp[log a + log b]. Building
+// the tables also checks that the modulus is irreducible (otherwise there is no element
+// of order P^N - 1). Larger fields multiply schoolbook and reduce by the modulus, and
+// invert with the extended Euclidean algorithm.
+//
+//   using F = GaloisField<3, 5, array<int, 5>{1, 2, 0, 0, 0}>;   // GF(3^5), a^5 + 2a + 1
+//   F x = F::generator(), y = x.pow(7) / (x + F(1));
+
+inline constexpr unsigned GF_TABLE_MAX_ORDER = 1 << 16;
+
+// P^N, or 0 if it does not fit in 64 bits.
+constexpr unsigned long long gf_order(unsigned long long p, int n) {
+    unsigned long long q = 1;
+    for (int i = 0; i < n; i++) {
+        if(q > ~0ULL / p)
+            return 0;
+        q *= p;
+    }
+    return q;
+}
+
+template<int P, int N, array<int, N> Modulus>
+struct GaloisField {
+    static_assert(P >= 2 && N >= 1, "GaloisField needs a prime P and a degree N >= 1");
+
+    // Smallest unsigned type that holds a coefficient.
+    typedef conditional_t<(P <= 256), uint8_t, conditional_t<(P <= 65536), uint16_t, uint32_t>> coeff_type;
+
+    static constexpr unsigned long long ORDER = gf_order(P, N);
+    static constexpr bool HAS_TABLES = ORDER != 0 && ORDER <= GF_TABLE_MAX_ORDER;
+
+    array<coeff_type, N> c{}; // Coefficients of 1, a, ..., a^(N-1).
+
+    constexpr GaloisField() = default;
+    // The constant v (an element of the prime field).
+    constexpr GaloisField(long long v) {
+        c[0] = (coeff_type)reduce_scalar(v);
+    }
+    constexpr explicit GaloisField(const array<coeff_type, N>& coeffs) {
+        for (int i = 0; i < N; i++)
+            c[i] = (coeff_type)(coeffs[i] % P);
+    }
+
+    static constexpr int characteristic() { return P; }
+    static constexpr int degree() { return N; }
+    static constexpr unsigned long long order() { return ORDER; }
+
+    // The class of a, a root of the modulus.
+    static constexpr GaloisField generator() {
+        GaloisField g;
+        if(N == 1)
+            g.c[0] = (coeff_type)reduce_scalar(-(long long)Modulus[0]);
+        else
+            g.c[1] = 1;
+        return g;
+    }
+
+    // The element as a number in base P (coefficient i is digit i), and back.
+    constexpr unsigned long long index() const {
+        unsigned long long idx = 0;
+        for (int i = N; i-- > 0;)
+            idx = idx * P + c[i];
+        return idx;
+    }
+    static constexpr GaloisField from_index(unsigned long long idx) {
+        GaloisField r;
+        for (int i = 0; i < N; i++) {
+            r.c[i] = (coeff_type)(idx % P);
+            idx /= P;
+        }
+        return r;
+    }
+
+    constexpr bool is_zero() const {
+        for (int i = 0; i < N; i++)
+            if(c[i] != 0)
+                return false;
+        return true;
+    }
+
+    constexpr GaloisField& operator+=(const GaloisField& o) {
+        for (int i = 0; i < N; i++) {
+            uint32_t s = (uint32_t)c[i] + o.c[i];
+            c[i] = (coeff_type)(s >= (uint32_t)P ? s - P : s);
+        }
+        return *this;
+    }
+    constexpr GaloisField& operator-=(const GaloisField& o) {
+        for (int i = 0; i < N; i++)
+            c[i] = (coeff_type)(c[i] >= o.c[i] ? c[i] - o.c[i] : c[i] + (P - o.c[i]));
+        return *this;
+    }
+    constexpr GaloisField& operator*=(const GaloisField& o) {
+        if(HAS_TABLES && !is_constant_evaluated()) {
+            unsigned long long i = index(), j = o.index();
+            if(i == 0 || j == 0)
+                return *this = GaloisField();
+            const Tables& t = tables();
+            return *this = t.exp[t.log[i] + t.log[j]];
+        }
+        return *this = multiply(*this, o);
+    }
+    constexpr GaloisField& operator/=(const GaloisField& o) {
+        return *this *= o.inv();
+    }
+    constexpr GaloisField operator-() const {
+        return GaloisField() - *this;
+    }
+
+    constexpr GaloisField pow(unsigned long long exp) const {
+        GaloisField base = *this, result(1);
+        while(exp) {
+            if(exp & 1)
+                result *= base;
+            base *= base;
+            exp >>= 1;
+        }
+        return result;
+    }
+
+    // Throws for zero (and, with a reducible modulus, for zero divisors).
+    constexpr GaloisField inv() const {
+        if(is_zero())
+            throw runtime_error("Zero has no inverse in GF(p^n)");
+        if(HAS_TABLES && !is_constant_evaluated()) {
+            const Tables& t = tables();
+            return t.exp[(ORDER - 1) - t.log[index()]];
+        }
+        return inverse_euclid(*this);
+    }
+
+    friend constexpr GaloisField operator+(GaloisField a, const GaloisField& b) { return a += b; }
+    friend constexpr GaloisField operator-(GaloisField a, const GaloisField& b) { return a -= b; }
+    friend constexpr GaloisField operator*(GaloisField a, const GaloisField& b) { return a *= b; }
+    friend constexpr GaloisField operator/(GaloisField a, const GaloisField& b) { return a /= b; }
+    friend constexpr bool operator==(const GaloisField& a, const GaloisField& b) { return a.c == b.c; }
+    friend constexpr bool operator!=(const GaloisField& a, const GaloisField& b) { return a.c != b.c; }
+
+    // Written as a polynomial in a, for example "(a^2+2a+1)"; parenthesized when it has
+    // several terms so that it reads unambiguously as a polynomial coefficient.
+    friend ostream& operator<<(ostream& os, const GaloisField& e) {
+        int terms = 0;
+        for (int i = 0; i < N; i++)
+            terms += e.c[i] != 0;
+        if(terms > 1)
+            os << "(";
+        bool first = true;
+        for (int i = N; i-- > 0;) {
+            if(e.c[i] == 0)
+                continue;
+            if(!first)
+                os << "+";
+            first = false;
+            if(e.c[i] != 1 || i == 0)
+                os << (unsigned)e.c[i];
+            if(i >= 1)
+                os << "a";
+            if(i >= 2)
+                os << "^" << i;
+        }
+        if(first)
+            os << "0";
+        if(terms > 1)
+            os << ")";
+        return os;
+    }
+
+    // Schoolbook product reduced by the monic modulus, highest term first.
+    static constexpr GaloisField multiply(const GaloisField& a, const GaloisField& b) {
+        array<unsigned long long, 2 * N - 1> prod{};
+        for (int i = 0; i < N; i++) {
+            if(a.c[i] == 0)
+                continue;
+            for (int j = 0; j < N; j++)
+                prod[i+j] = (prod[i+j] + (unsigned long long)a.c[i] * b.c[j]) % P;
+        }
+        for (int k = 2 * N - 2; k >= N; k--) {
+            unsigned long long t = prod[k];
+            if(t == 0)
+                continue;
+            // a^k = a^(k-N) * a^N and a^N = -(Modulus[0] + ... + Modulus[N-1] a^(N-1)).
+            for (int i = 0; i < N; i++)
+                prod[k-N+i] = (prod[k-N+i] + (P - t) * reduce_scalar(Modulus[i])) % P;
+        }
+        GaloisField r;
+        for (int i = 0; i < N; i++)
+            r.c[i] = (coeff_type)prod[i];
+        return r;
+    }
+
+private:
+    struct Tables {
+        vector<uint16_t> log;     // log[i] for the element of index i (unused for 0)
+        vector<GaloisField> exp;  // exp[k] = g^k, for k < 2 (q - 1) so sums need no wrap
+    };
+
+    static constexpr unsigned long long reduce_scalar(long long v) {
+        long long r = v % P;
+        return (unsigned long long)(r < 0 ? r + P : r);
+    }
+    static constexpr unsigned long long scalar_inv(unsigned long long v) {
+        unsigned long long result = 1, e = P - 2;
+        while(e) {
+            if(e & 1)
+                result = (unsigned long long)((unsigned __int128)result * v % P);
+            v = (unsigned long long)((unsigned __int128)v * v % P);
+            e >>= 1;
+        }
+        return result;
+    }
+
+    // Extended Euclid of the modulus and x on fixed-size arrays; keeps the invariant
+    // r_i = t_i * x (mod m) and stops at a constant remainder.
+    static constexpr GaloisField inverse_euclid(const GaloisField& x) {
+        typedef array<unsigned long long, N + 1> Poly;
+        Poly r0{}, r1{}, t0{}, t1{};
+        for (int i = 0; i < N; i++) {
+            r0[i] = reduce_scalar(Modulus[i]);
+            r1[i] = x.c[i];
+        }
+        r0[N] = 1;
+        t1[0] = 1;
+        auto deg = [](const Poly& p) {
+            int d = N;
+            while(d >= 0 && p[d] == 0)
+                d--;
+            return d;
+        };
+        int d1 = deg(r1);
+        while(d1 > 0) {
+            int d0 = deg(r0);
+            unsigned long long lead_inv = scalar_inv(r1[d1]);
+            while(d0 >= d1) {
+                unsigned long long f = r0[d0] * lead_inv % P;
+                int shift = d0 - d1;
+                for (int i = 0; i + shift <= N; i++) {
+                    r0[i+shift] = (r0[i+shift] + (P - f) * r1[i]) % P;
+                    t0[i+shift] = (t0[i+shift] + (P - f) * t1[i]) % P;
+                }
+                d0 = deg(r0);
+            }
+            swap(r0, r1);
+            swap(t0, t1);
+            d1 = d0;
+        }
+        if(d1 < 0)
+            throw runtime_error("Element is not invertible: the GF(p^n) modulus is reducible");
+        unsigned long long s = scalar_inv(r1[0]);
+        GaloisField r;
+        for (int i = 0; i < N; i++)
+            r.c[i] = (coeff_type)(t1[i] * s % P);
+        return r;
+    }
+
+    // Finds an element of order q - 1 and tabulates its powers.
+    static Tables build_tables() {
+        const uint32_t q = (uint32_t)ORDER;
+        Tables t;
+        t.log.assign(q, 0);
+        t.exp.assign(2 * (q - 1), GaloisField());
+        vector<bool> seen(q, false); // powers of rejected candidates, which cannot be primitive
+        for (uint32_t i = 0; i < q; i++) {
+            // Tries the generator a first; it is primitive for primitive moduli.
+            GaloisField g = i == 0 ? generator() : from_index(i);
+            if(g.is_zero() || seen[g.index()])
+                continue;
+            GaloisField power(1);
+            uint32_t k = 0;
+            do {
+                t.exp[k] = power;
+                seen[power.index()] = true;
+                power = multiply(power, g);
+                k++;
+            } while(k < q - 1 && power != GaloisField(1));
+            if(k == q - 1 && power == GaloisField(1)) {
+                for (uint32_t j = 0; j < q - 1; j++) {
+                    t.log[t.exp[j].index()] = (uint16_t)j;
+                    t.exp[j + q - 1] = t.exp[j];
+                }
+                return t;
+            }
+        }
+        throw runtime_error("GF(p^n) modulus is not irreducible");
+    }
+
+    static const Tables& tables() {
+        static const Tables t = build_tables();
+        return t;
+    }
+};
+
+// Common fields. GF(2^8) uses the Reed-Solomon polynomial a^8 + a^4 + a^3 + a^2 + 1.
+typedef GaloisField<2, 8, array<int, 8>{1, 0, 1, 1, 1, 0, 0, 0}> GF256;
+typedef GaloisField<2, 16, array<int, 16>{1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0}> GF65536;
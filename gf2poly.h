@@ -0,0 +1,429 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include "polynomial.h"
+#include "modint.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//////////////////////////////
+// gf2poly.h
+//////////////////////////////
+
+// Bit-packed polynomials over Z_2: coefficient i is bit i % 64 of word i / 64, so adding
+// and subtracting are word XORs. Words are multiplied carry-less with PCLMULQDQ when the
+// CPU has it (detected once at runtime), or with a portable 4-bit window otherwise;
+// long operands use Karatsuba on words. Reduction by a fixed modulus (GF2Modulus) XORs
+// prebuilt shifted copies of the modulus, one per bit offset, so it never shifts at
+// runtime; moduli of degree GF2_BARRETT_MIN_DEGREE and up reduce with two products
+// (Barrett) instead.
+//
+// FactorRingElement<ModInt<2>> and is_irreducible over ModInt<2> use these routines
+// (see factor_ring.h); convert with GF2Poly(p) and to_polynomial().
+
+// Operands of at least this many words use Karatsuba.
+inline constexpr size_t GF2_KARATSUBA_WORDS = 16;
+inline constexpr int GF2_BARRETT_MIN_DEGREE = 512;
+
+inline bool gf2_has_clmul() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    static const bool has = __builtin_cpu_supports("pclmul");
+    return has;
+#else
+    return false;
+#endif
+}
+
+// Carry-less 64x64 -> 128-bit product from a table of a times every 4-bit polynomial.
+inline unsigned __int128 clmul64_portable(uint64_t a, uint64_t b) {
+    unsigned __int128 table[16];
+    table[0] = 0;
+    table[1] = a;
+    for (int i = 2; i < 16; i += 2) {
+        table[i] = table[i / 2] << 1;
+        table[i + 1] = table[i] ^ a;
+    }
+    unsigned __int128 r = 0;
+    for (int shift = 60; shift >= 0; shift -= 4)
+        r = (r << 4) ^ table[(b >> shift) & 15];
+    return r;
+}
+
+// res[i+j .. i+j+1] ^= a[i] * b[j]. res must hold n + m words.
+inline void gf2_mul_schoolbook_portable(const uint64_t* a, size_t n, const uint64_t* b, size_t m, uint64_t* res) {
+    for (size_t i = 0; i < n; i++) {
+        if(a[i] == 0)
+            continue;
+        for (size_t j = 0; j < m; j++) {
+            unsigned __int128 p = clmul64_portable(a[i], b[j]);
+            res[i+j] ^= (uint64_t)p;
+            res[i+j+1] ^= (uint64_t)(p >> 64);
+        }
+    }
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+__attribute__((target("pclmul,sse4.1")))
+inline void gf2_mul_schoolbook_pclmul(const uint64_t* a, size_t n, const uint64_t* b, size_t m, uint64_t* res) {
+    for (size_t i = 0; i < n; i++) {
+        if(a[i] == 0)
+            continue;
+        __m128i x = _mm_cvtsi64_si128((long long)a[i]);
+        for (size_t j = 0; j < m; j++) {
+            __m128i p = _mm_clmulepi64_si128(x, _mm_cvtsi64_si128((long long)b[j]), 0);
+            res[i+j] ^= (uint64_t)_mm_cvtsi128_si64(p);
+            res[i+j+1] ^= (uint64_t)_mm_extract_epi64(p, 1);
+        }
+    }
+}
+#endif
+
+inline void gf2_mul_schoolbook(const uint64_t* a, size_t n, const uint64_t* b, size_t m, uint64_t* res) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    if(gf2_has_clmul()) {
+        gf2_mul_schoolbook_pclmul(a, n, b, m, res);
+        return;
+    }
+#endif
+    gf2_mul_schoolbook_portable(a, n, b, m, res);
+}
+
+// Karatsuba on words for two n-word operands: res[0 .. 2n) ^= a * b. Over Z_2 the
+// middle term is (a0 + a1)(b0 + b1) + a0*b0 + a1*b1, all XORs.
+inline void gf2_karatsuba(const uint64_t* a, const uint64_t* b, size_t n, uint64_t* res) {
+    if(n < GF2_KARATSUBA_WORDS) {
+        gf2_mul_schoolbook(a, n, b, n, res);
+        return;
+    }
+    size_t h = n / 2, k = n - h;
+    vector<uint64_t> z0(2*h, 0), z1(2*k, 0), z2(2*k, 0);
+    vector<uint64_t> as(a + h, a + n), bs(b + h, b + n);
+    for (size_t i = 0; i < h; i++) {
+        as[i] ^= a[i];
+        bs[i] ^= b[i];
+    }
+    gf2_karatsuba(a, b, h, z0.data());
+    gf2_karatsuba(a + h, b + h, k, z2.data());
+    gf2_karatsuba(as.data(), bs.data(), k, z1.data());
+    for (size_t i = 0; i < z0.size(); i++) {
+        z1[i] ^= z0[i];
+        res[i] ^= z0[i];
+    }
+    for (size_t i = 0; i < z2.size(); i++) {
+        z1[i] ^= z2[i];
+        res[i+2*h] ^= z2[i];
+    }
+    for (size_t i = 0; i < z1.size(); i++)
+        res[i+h] ^= z1[i];
+}
+
+// res[0 .. n+m) ^= a * b for any sizes; the longer operand is cut into chunks as long
+// as the shorter one.
+inline void gf2_mul_add(const uint64_t* a, size_t n, const uint64_t* b, size_t m, uint64_t* res) {
+    if(n < m) {
+        swap(a, b);
+        swap(n, m);
+    }
+    if(m < GF2_KARATSUBA_WORDS) {
+        gf2_mul_schoolbook(a, n, b, m, res);
+        return;
+    }
+    vector<uint64_t> chunk(m);
+    for (size_t i = 0; i < n; i += m) {
+        size_t len = min(m, n - i);
+        fill(copy(a + i, a + i + len, chunk.begin()), chunk.end(), 0);
+        vector<uint64_t> prod(2*m, 0);
+        gf2_karatsuba(chunk.data(), b, m, prod.data());
+        for (size_t j = 0; j < 2*m && i + j < n + m; j++)
+            res[i+j] ^= prod[j];
+    }
+}
+
+class GF2Poly {
+public:
+    vector<uint64_t> words; // Bit i of words[i / 64] is the coefficient of x^i; no zero top word.
+
+    GF2Poly() {}
+    explicit GF2Poly(vector<uint64_t> w) : words(move(w)) {
+        normalize();
+    }
+    explicit GF2Poly(const Polynomial<ModInt<2>>& p) : words((p.coeffs.size() + 63) / 64, 0) {
+        for (size_t i = 0; i < p.coeffs.size(); i++)
+            words[i / 64] |= (uint64_t)p.coeffs[i].value << (i % 64);
+        normalize();
+    }
+    // x^k.
+    static GF2Poly monomial(int k) {
+        GF2Poly r;
+        r.words.assign(k / 64 + 1, 0);
+        r.words[k / 64] = 1ULL << (k % 64);
+        return r;
+    }
+
+    Polynomial<ModInt<2>> to_polynomial() const {
+        vector<ModInt<2>> c(degree() + 1);
+        for (size_t i = 0; i < c.size(); i++)
+            c[i].value = (words[i / 64] >> (i % 64)) & 1;
+        return Polynomial<ModInt<2>>(move(c));
+    }
+
+    void normalize() {
+        while(!words.empty() && words.back() == 0)
+            words.pop_back();
+    }
+
+    int degree() const {
+        return words.empty() ? -1 : (int)(words.size() * 64 - 1) - __builtin_clzll(words.back());
+    }
+    bool coeff(int i) const {
+        return i >= 0 && i / 64 < (int)words.size() && (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    GF2Poly& operator+=(const GF2Poly& other) {
+        if(words.size() < other.words.size())
+            words.resize(other.words.size(), 0);
+        for (size_t i = 0; i < other.words.size(); i++)
+            words[i] ^= other.words[i];
+        normalize();
+        return *this;
+    }
+    GF2Poly& operator-=(const GF2Poly& other) {
+        return *this += other;
+    }
+    friend GF2Poly operator+(GF2Poly a, const GF2Poly& b) { return a += b; }
+    friend GF2Poly operator-(GF2Poly a, const GF2Poly& b) { return a += b; }
+
+    friend GF2Poly operator*(const GF2Poly& a, const GF2Poly& b) {
+        if(a.words.empty() || b.words.empty())
+            return GF2Poly();
+        vector<uint64_t> res(a.words.size() + b.words.size(), 0);
+        gf2_mul_add(a.words.data(), a.words.size(), b.words.data(), b.words.size(), res.data());
+        return GF2Poly(move(res));
+    }
+
+    // a^2: squaring over Z_2 is linear, it only spreads bit i to bit 2i.
+    GF2Poly square() const {
+        vector<uint64_t> res(2 * words.size());
+        for (size_t i = 0; i < words.size(); i++) {
+            res[2*i] = spread_bits((uint32_t)words[i]);
+            res[2*i+1] = spread_bits((uint32_t)(words[i] >> 32));
+        }
+        return GF2Poly(move(res));
+    }
+
+    // The bits of a polynomial of degree at least k, shifted down by k (floor(a / x^k)).
+    GF2Poly shifted_down(int k) const {
+        size_t w = k / 64, s = k % 64;
+        if(w >= words.size())
+            return GF2Poly();
+        vector<uint64_t> res(words.size() - w);
+        for (size_t i = 0; i < res.size(); i++) {
+            res[i] = words[i+w] >> s;
+            if(s && i + w + 1 < words.size())
+                res[i] |= words[i+w+1] << (64 - s);
+        }
+        return GF2Poly(move(res));
+    }
+    // a mod x^k.
+    GF2Poly truncated(int k) const {
+        size_t w = (k + 63) / 64;
+        vector<uint64_t> res(words.begin(), words.begin() + min(w, words.size()));
+        if(k % 64 && res.size() == w)
+            res.back() &= (1ULL << (k % 64)) - 1;
+        return GF2Poly(move(res));
+    }
+
+    // Long division: returns the quotient, leaves the remainder in *this.
+    GF2Poly divide_by(const GF2Poly& divisor) {
+        int db = divisor.degree();
+        if(db < 0)
+            throw runtime_error("Division by zero polynomial");
+        int da = degree();
+        if(da < db)
+            return GF2Poly();
+        vector<uint64_t> quot((da - db) / 64 + 1, 0);
+        // Copies of the divisor shifted by 0 .. 63 bits, built only as needed.
+        vector<vector<uint64_t>> shifted(64);
+        for (int d = da; d >= db; d = top_bit_below(d)) {
+            int s = d - db;
+            vector<uint64_t>& copy_s = shifted[s % 64];
+            if(copy_s.empty())
+                copy_s = shift_words(divisor.words, s % 64);
+            xor_at(copy_s, s / 64);
+            quot[s / 64] |= 1ULL << (s % 64);
+        }
+        normalize();
+        return GF2Poly(move(quot));
+    }
+    friend GF2Poly operator/(GF2Poly a, const GF2Poly& b) {
+        return a.divide_by(b);
+    }
+    friend GF2Poly operator%(GF2Poly a, const GF2Poly& b) {
+        a.divide_by(b);
+        return a;
+    }
+
+    friend bool operator==(const GF2Poly& a, const GF2Poly& b) {
+        return a.words == b.words;
+    }
+    friend bool operator!=(const GF2Poly& a, const GF2Poly& b) {
+        return a.words != b.words;
+    }
+    friend ostream& operator<<(ostream& os, const GF2Poly& p) {
+        return os << p.to_polynomial();
+    }
+
+    // words shifted up by s < 64 bits.
+    static vector<uint64_t> shift_words(const vector<uint64_t>& w, int s) {
+        vector<uint64_t> res(w.size() + 1, 0);
+        for (size_t i = 0; i < w.size(); i++) {
+            res[i] |= w[i] << s;
+            if(s)
+                res[i+1] |= w[i] >> (64 - s);
+        }
+        while(!res.empty() && res.back() == 0)
+            res.pop_back();
+        return res;
+    }
+
+    // words[offset + i] ^= w[i].
+    void xor_at(const vector<uint64_t>& w, size_t offset) {
+        for (size_t i = 0; i < w.size(); i++)
+            words[offset + i] ^= w[i];
+    }
+
+    // Highest set bit below position d, or -1.
+    int top_bit_below(int d) const {
+        if(d <= 0)
+            return -1;
+        int w = (d - 1) / 64;
+        uint64_t bits = words[w] & (~0ULL >> (63 - (d - 1) % 64));
+        while(bits == 0) {
+            if(--w < 0)
+                return -1;
+            bits = words[w];
+        }
+        return w * 64 + 63 - __builtin_clzll(bits);
+    }
+
+private:
+    static uint64_t spread_bits(uint32_t x) {
+        uint64_t v = x;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v << 2)) & 0x3333333333333333ULL;
+        v = (v | (v << 1)) & 0x5555555555555555ULL;
+        return v;
+    }
+};
+
+inline GF2Poly gf2_gcd(GF2Poly a, GF2Poly b) {
+    while(!b.words.empty()) {
+        a.divide_by(b);
+        swap(a, b);
+    }
+    return a;
+}
+
+// Precomputed data for arithmetic modulo a fixed polynomial f.
+class GF2Modulus {
+public:
+    GF2Poly f;
+
+    explicit GF2Modulus(const GF2Poly& f) : f(f), n(f.degree()) {
+        if(n < 0)
+            throw runtime_error("Factor ring modulus must be nonzero");
+        if(n >= GF2_BARRETT_MIN_DEGREE) {
+            mu = GF2Poly::monomial(2 * n) / f; // floor(x^2n / f)
+        } else {
+            for (int s = 0; s < 64; s++)
+                shifted[s] = GF2Poly::shift_words(f.words, s);
+        }
+    }
+
+    int degree() const {
+        return n;
+    }
+
+    // a mod f.
+    GF2Poly reduce(GF2Poly a) const {
+        int da = a.degree();
+        if(da < n)
+            return a;
+        if(mu.degree() >= 0) {
+            if(da >= 2 * n)
+                return a % f;
+            // Barrett: for deg a < 2n the quotient is exactly floor(floor(a / x^n) * mu / x^n).
+            GF2Poly q = (a.shifted_down(n) * mu).shifted_down(n);
+            return (a + q * f).truncated(n);
+        }
+        for (int d = da; d >= n; d = a.top_bit_below(d)) {
+            int s = d - n;
+            a.xor_at(shifted[s % 64], s / 64);
+        }
+        a.normalize();
+        return a;
+    }
+
+    GF2Poly mul(const GF2Poly& a, const GF2Poly& b) const {
+        return reduce(a * b);
+    }
+    GF2Poly square(const GF2Poly& a) const {
+        return reduce(a.square());
+    }
+    GF2Poly pow(GF2Poly base, unsigned long long exponent) const {
+        GF2Poly result = reduce(GF2Poly::monomial(0));
+        base = reduce(move(base));
+        while(exponent) {
+            if(exponent & 1)
+                result = mul(result, base);
+            base = square(base);
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+private:
+    int n;
+    vector<uint64_t> shifted[64]; // f shifted up by 0 .. 63 bits (small moduli)
+    GF2Poly mu;                   // floor(x^2n / f) (large moduli)
+};
+
+// Ben-Or test over Z_2: f of degree n is irreducible iff gcd(x^(2^i) - x, f) = 1 for
+// i = 1 .. n/2. Each Frobenius step is one squaring, which over Z_2 is a bit spread.
+inline bool gf2_is_irreducible(const GF2Poly& f) {
+    int deg = f.degree();
+    if(deg <= 0)
+        return false;
+    if(deg == 1)
+        return true;
+    GF2Modulus ring(f);
+    GF2Poly x = ring.reduce(GF2Poly::monomial(1)), frobenius = x;
+    for (int i = 1; i <= deg / 2; i++) {
+        frobenius = ring.square(frobenius);
+        if(gf2_gcd(f, frobenius + x).degree() > 0)
+            return false;
+    }
+    return true;
+}
+
+// Per-ring data kept by ModulusContext<T>: rings over Z_2 hold a packed copy of the
+// modulus, other rings nothing.
+template<typename T>
+struct PackedModulus {
+    explicit PackedModulus(const Polynomial<T>&) {}
+};
+template<>
+struct PackedModulus<ModInt<2>> {
+    GF2Modulus ring;
+    explicit PackedModulus(const Polynomial<ModInt<2>>& f) : ring(GF2Poly(f)) {}
+};
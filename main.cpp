@@ -1,6 +1,10 @@
 #include "polynomial.h"
 #include "factor_ring.h"
 #include "modint.h"
+#include "dynmodint.h"
+#include "factorization.h"
+#include "batch.h"
+#include "bigint.h"
 
 
 
@@ -8,7 +12,52 @@
 // main.cpp
 //////////////////////////////
 
-int main() {
+// Prompts for the prime p of the field F = Z_p and installs it as the DynModInt modulus.
+// Returns false (after printing why) if p is not a supported prime.
+bool read_prime_field(long long& prime) {
+    cout << "\nEnter a prime number for the field F = Z_p: ";
+    cin >> prime;
+    // Verify that the number is prime.
+    if(!is_prime_u64(prime < 0 ? 0 : (uint64_t)prime)) {
+        cout << prime << " is not a prime number.\n";
+        return false;
+    }
+    if(prime >= (1LL << 62)) {
+        cout << "Prime " << prime << " is too large (the limit is 2^62).\n";
+        return false;
+    }
+    if(prime != 2)
+        DynModInt<>::set_mod(prime);
+    return true;
+}
+
+// Like read_polynomial, but the coefficients are integers of any size.
+Polynomial<BigInt> read_integer_polynomial() {
+    int n;
+    cout << "Enter the number of coefficients: ";
+    cin >> n;
+    vector<BigInt> coeff(max(0, n));
+    cout << "Enter the coefficients (constant term first): ";
+    for (auto &c : coeff)
+        cin >> c;
+    return Polynomial<BigInt>(move(coeff));
+}
+
+int main(int argc, char* argv[]) {
+    // Builds with -DPOLYCALC_PROFILE print a profile summary when main returns.
+    PROFILE_REPORT_AT_EXIT();
+
+    // polycalc --threads N ...: size of the pool used by large multiplications.
+    if(argc >= 3 && string(argv[1]) == "--threads") {
+        ThreadPool::set_shared_threads((unsigned)max(1, atoi(argv[2])));
+        argc -= 2;
+        argv += 2;
+    }
+
+    // polycalc --batch [file]: process operation records from the file (or stdin).
+    if(argc >= 2 && string(argv[1]) == "--batch")
+        return batch_main(argc >= 3 ? argv[2] : nullptr);
+
     cout << "Polynomial Calculator\n";
     cout << "Select an operation:\n";
     cout << "1. Addition of two polynomials\n";
@@ -18,38 +67,39 @@ int main() {
     cout << "5. Exponentiation of a polynomial\n";
     cout << "6. Evaluate a polynomial at a given point\n";
     cout << "7. Factor ring operations (Field extension F[x]/(f(x)))\n";
+    cout << "8. Factorization of a polynomial over Z_p\n";
+    cout << "9. Evaluate a polynomial at every point of a binary file of doubles\n";
 
     int op;
     cout << "Your choice: ";
     cin >> op;
 
-    if(op >= 1 && op <= 6) {
-        // For operations 1-6 we use type double for coefficients.
-        Polynomial<double> p, q;
-        double x;
+    if(op == 1 || op == 2 || op == 3 || op == 5) {
+        // Sums, differences, products and powers stay in Z, so they are computed exactly.
+        Polynomial<BigInt> p, q;
         int exp;
-        switch(op) {
-            case 1:
-                cout << "Polynomial A:\n";
-                p = read_polynomial<double>();
-                cout << "Polynomial B:\n";
-                q = read_polynomial<double>();
+        cout << "Polynomial A:\n";
+        p = read_integer_polynomial();
+        if(op == 5) {
+            cout << "Enter a non-negative exponent: ";
+            cin >> exp;
+            cout << "A^" << exp << " = " << p.pow(exp) << "\n";
+        } else {
+            cout << "Polynomial B:\n";
+            q = read_integer_polynomial();
+            if(op == 1)
                 cout << "A + B = " << p + q << "\n";
-                break;
-            case 2:
-                cout << "Polynomial A:\n";
-                p = read_polynomial<double>();
-                cout << "Polynomial B:\n";
-                q = read_polynomial<double>();
+            else if(op == 2)
                 cout << "A - B = " << p - q << "\n";
-                break;
-            case 3:
-                cout << "Polynomial A:\n";
-                p = read_polynomial<double>();
-                cout << "Polynomial B:\n";
-                q = read_polynomial<double>();
+            else
                 cout << "A * B = " << p * q << "\n";
-                break;
+        }
+    }
+    else if(op == 4 || op == 6) {
+        // Division and evaluation at a real point use type double for coefficients.
+        Polynomial<double> p, q;
+        double x;
+        switch(op) {
             case 4:
                 cout << "Dividend polynomial A:\n";
                 p = read_polynomial<double>();
@@ -63,13 +113,6 @@ int main() {
                     cout << "Error: " << e.what() << "\n";
                 }
                 break;
-            case 5:
-                cout << "Polynomial A:\n";
-                p = read_polynomial<double>();
-                cout << "Enter a non-negative exponent: ";
-                cin >> exp;
-                cout << "A^" << exp << " = " << p.pow(exp) << "\n";
-                break;
             case 6:
                 cout << "Polynomial A:\n";
                 p = read_polynomial<double>();
@@ -79,32 +122,31 @@ int main() {
                 break;
         }
     } 
-    else if(op == 7) {
-        int prime;
-        cout << "\nEnter a prime number for the field F = Z_p: ";
-        cin >> prime;
-        // Verify that the number is prime.
-        bool isPrime = true;
-        if(prime < 2)
-            isPrime = false;
-        for (int i = 2; i * i <= prime; i++) {
-            if(prime % i == 0) {
-                isPrime = false;
-                break;
+    else if(op == 7 || op == 8) {
+        long long prime;
+        if(read_prime_field(prime)) {
+            // Montgomery form needs an odd modulus, so Z_2 keeps its compile-time type.
+            if(op == 7) {
+                if(prime == 2) run_factor_ring<ModInt<2>>();
+                else run_factor_ring<DynModInt<>>();
+            } else {
+                if(prime == 2) run_factorization<ModInt<2>>();
+                else run_factorization<DynModInt<>>();
             }
         }
-        if(!isPrime) {
-            cout << prime << " is not a prime number.\n";
-        } else {
-            // For demonstration we support a limited set of primes.
-            if(prime == 2) run_factor_ring<2>();
-            else if(prime == 3) run_factor_ring<3>();
-            else if(prime == 5) run_factor_ring<5>();
-            else if(prime == 7) run_factor_ring<7>();
-            else if(prime == 11) run_factor_ring<11>();
-            else {
-                cout << "Prime " << prime << " is not supported in this demo.\n";
-            }
+    } else if(op == 9) {
+        cout << "Polynomial A:\n";
+        Polynomial<double> p = read_polynomial<double>();
+        string in_path, out_path;
+        cout << "Input file of points: ";
+        cin >> in_path;
+        cout << "Output file for the values: ";
+        cin >> out_path;
+        try {
+            size_t count = evaluate_stream(p.coeffs, in_path, out_path);
+            cout << "Evaluated A at " << count << " points.\n";
+        } catch (const runtime_error &e) {
+            cout << "Error: " << e.what() << "\n";
         }
     } else {
         cout << "Unknown operation!\n";
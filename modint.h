@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <tuple>
 #include <algorithm>
+#include "profile.h"
 
 using namespace std;
 
@@ -20,13 +21,17 @@ struct ModInt {
     int value;
     static constexpr int MOD_VALUE = MOD;
     
-    ModInt(int v = 0) {
-        value = v % MOD;
+    ModInt(long long v = 0) {
+        value = (int)(v % MOD);
         if (value < 0)
             value += MOD;
     }
     ModInt(const ModInt &other) : value(other.value) {}
 
+    // Uniform accessors shared with DynModInt, used by generic field code.
+    static constexpr int mod() { return MOD; }
+    int val() const { return value; }
+
     ModInt& operator+=(const ModInt &other) {
         value += other.value;
         if(value >= MOD)
@@ -57,6 +62,7 @@ struct ModInt {
     }
     // Assuming MOD is prime.
     ModInt inv() const {
+        PROFILE_SCOPE(ModInverse);
         return pow(MOD - 2);
     }
     ModInt& operator/=(const ModInt &other) {
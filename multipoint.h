@@ -0,0 +1,168 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <span>
+#include <type_traits>
+#include "polynomial.h"
+#include "simd_eval.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+//////////////////////////////
+// multipoint.h
+//////////////////////////////
+
+// Evaluation at many points and interpolation through a subproduct tree.
+// Node [l, r) of the tree holds prod (x - x_i) over its points. Evaluation reduces f
+// down the tree (a remainder tree), and interpolation sums the Lagrange terms back up,
+// both in O(M(n) log n). The two subtrees of a large node are processed in parallel.
+
+// Ranges of at most this many points are handled directly (Horner, synthetic division).
+inline constexpr int MULTIPOINT_LEAF = 32;
+// Subtrees covering at least this many points run as tasks on the shared thread pool.
+inline constexpr int MULTIPOINT_PARALLEL_MIN = 4096;
+
+template<typename T>
+class SubproductTree {
+public:
+    explicit SubproductTree(span<const T> pts) : points(pts.begin(), pts.end()) {
+        if(!points.empty()) {
+            tree.resize(4 * points.size());
+            build(1, 0, size());
+        }
+    }
+
+    int size() const {
+        return points.size();
+    }
+
+    // prod (x - x_i) over all points.
+    const Polynomial<T>& root() const {
+        return tree[1];
+    }
+
+    // f(x_i) for every point.
+    vector<T> evaluate(const Polynomial<T>& f) const {
+        vector<T> out(points.size());
+        if(!points.empty())
+            descend(1, 0, size(), f % root(), out);
+        return out;
+    }
+
+    // The polynomial of degree < n with value values[i] at x_i. Points must be distinct.
+    Polynomial<T> interpolate(span<const T> values) const {
+        if(values.size() != points.size())
+            throw invalid_argument("Interpolation needs one value per point");
+        if(points.empty())
+            return Polynomial<T>();
+        // Lagrange weights y_i / M'(x_i), where M is the product at the root.
+        vector<T> weights = evaluate(derivative(root()));
+        for (size_t i = 0; i < weights.size(); i++) {
+            if(weights[i] == T(0))
+                throw invalid_argument("Interpolation points must be distinct");
+            weights[i] = values[i] / weights[i];
+        }
+        return combine(1, 0, size(), weights);
+    }
+
+private:
+    vector<T> points;
+    vector<Polynomial<T>> tree; // Node k has children 2k and 2k + 1.
+
+    template<typename Left, typename Right>
+    static void fork_join(int range, Left&& left, Right&& right) {
+        if(parallel_worthwhile(range, MULTIPOINT_PARALLEL_MIN)) {
+            parallel_invoke(left, right);
+        } else {
+            left();
+            right();
+        }
+    }
+
+    void build(int node, int l, int r) {
+        if(r - l <= MULTIPOINT_LEAF) {
+            vector<T> prod = {T(1)};
+            for (int i = l; i < r; i++) {
+                // prod *= (x - x_i)
+                prod.push_back(T(0));
+                for (size_t k = prod.size() - 1; k > 0; k--)
+                    prod[k] = prod[k-1] - points[i] * prod[k];
+                prod[0] = T(0) - points[i] * prod[0];
+            }
+            tree[node] = Polynomial<T>(prod);
+            return;
+        }
+        int mid = (l + r) / 2;
+        fork_join(r - l, [&] { build(2 * node, l, mid); }, [&] { build(2 * node + 1, mid, r); });
+        tree[node] = tree[2 * node] * tree[2 * node + 1];
+    }
+
+    // f is already reduced modulo tree[node].
+    void descend(int node, int l, int r, const Polynomial<T>& f, vector<T>& out) const {
+        if(r - l <= MULTIPOINT_LEAF) {
+            for (int i = l; i < r; i++)
+                out[i] = f.evaluate(points[i]);
+            return;
+        }
+        int mid = (l + r) / 2;
+        fork_join(r - l,
+                  [&] { descend(2 * node, l, mid, f % tree[2 * node], out); },
+                  [&] { descend(2 * node + 1, mid, r, f % tree[2 * node + 1], out); });
+    }
+
+    // sum over i in [l, r) of w_i * prod_{j != i} (x - x_j), with j ranging over [l, r).
+    Polynomial<T> combine(int node, int l, int r, const vector<T>& w) const {
+        if(r - l <= MULTIPOINT_LEAF) {
+            const vector<T>& prod = tree[node].coeffs;
+            int d = prod.size() - 1;
+            vector<T> sum(d, T(0));
+            for (int i = l; i < r; i++) {
+                // Synthetic division prod / (x - x_i), accumulated with weight w_i.
+                T q = prod[d];
+                for (int k = d - 1; k >= 0; k--) {
+                    sum[k] = sum[k] + w[i] * q;
+                    q = prod[k] + points[i] * q;
+                }
+            }
+            return Polynomial<T>(sum);
+        }
+        int mid = (l + r) / 2;
+        Polynomial<T> left, right;
+        fork_join(r - l, [&] { left = combine(2 * node, l, mid, w); },
+                  [&] { right = combine(2 * node + 1, mid, r, w); });
+        return left * tree[2 * node + 1] + right * tree[2 * node];
+    }
+};
+
+// Batch evaluation. Exact coefficient types use the subproduct tree once both the degree
+// and the number of points are large. Floating-point types stay with Horner, since the
+// remainder tree is numerically unstable for them; doubles use the SIMD kernels.
+template<typename T>
+vector<T> Polynomial<T>::evaluate(span<const T> points) const {
+    if constexpr (is_same_v<T, double>) {
+        vector<double> out(points.size());
+        evaluate_batch(coeffs, points.data(), out.data(), points.size());
+        return out;
+    } else if constexpr (!is_floating_point_v<T>) {
+        if(degree() > MULTIPOINT_LEAF && (int)points.size() > MULTIPOINT_LEAF)
+            return SubproductTree<T>(points).evaluate(*this);
+    }
+    vector<T> out(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        out[i] = evaluate(points[i]);
+    return out;
+}
+
+// The polynomial of degree < n through the points (points[i], values[i]).
+template<typename T>
+Polynomial<T> interpolate(span<const T> points, span<const T> values) {
+    return SubproductTree<T>(points).interpolate(values);
+}
+template<typename T>
+Polynomial<T> interpolate(const vector<T>& points, const vector<T>& values) {
+    return interpolate(span<const T>(points), span<const T>(values));
+}
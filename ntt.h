@@ -0,0 +1,326 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include "modint.h"
+#include "convolution.h"
+
+using namespace std;
+
+//////////////////////////////
+// ntt.h
+//////////////////////////////
+
+// Number-theoretic transform for ModInt<MOD> coefficient vectors.
+// A prime MOD = c * 2^k + 1 admits transforms of length up to 2^k (998244353 = 119 * 2^23 + 1).
+// Other moduli are handled by convolving over several NTT primes and recombining with CRT.
+
+// Below this operand length Karatsuba beats the transform.
+inline constexpr size_t NTT_THRESHOLD = 128;
+// The multi-prime CRT path runs several transforms, so it pays off only for longer operands.
+inline constexpr size_t NTT_CRT_THRESHOLD = 1024;
+
+constexpr long long ntt_pow_mod(long long base, long long exp, long long mod) {
+    long long result = 1 % mod;
+    base %= mod;
+    while(exp > 0) {
+        if(exp & 1)
+            result = result * base % mod;
+        base = base * base % mod;
+        exp >>= 1;
+    }
+    return result;
+}
+
+// Smallest primitive root of the prime mod, or 0 if none is found (mod is not prime).
+constexpr int ntt_primitive_root(int mod) {
+    if(mod == 2)
+        return 1;
+    if(mod < 2)
+        return 0;
+    long long factors[32] = {};
+    int count = 0;
+    long long rest = mod - 1;
+    for (long long d = 2; d * d <= rest; d++) {
+        if(rest % d == 0) {
+            factors[count++] = d;
+            while(rest % d == 0)
+                rest /= d;
+        }
+    }
+    if(rest > 1)
+        factors[count++] = rest;
+    for (int g = 2; g < mod; g++) {
+        bool ok = true;
+        for (int i = 0; i < count && ok; i++)
+            ok = ntt_pow_mod(g, (mod - 1) / factors[i], mod) != 1;
+        if(ok)
+            return ntt_pow_mod(g, mod - 1, mod) == 1 ? g : 0;
+    }
+    return 0;
+}
+
+// 2-adic valuation of mod - 1: the largest supported transform is 2^max_log.
+constexpr int ntt_max_log(int mod) {
+    int k = 0;
+    long long m = mod - 1;
+    while(m > 0 && m % 2 == 0) {
+        m /= 2;
+        k++;
+    }
+    return k;
+}
+
+// Transforms of at least this length spread their butterflies over the shared pool.
+inline constexpr size_t NTT_PARALLEL_MIN = 1 << 15;
+inline constexpr size_t NTT_PARALLEL_GRAIN = 1 << 12;
+
+template<int MOD>
+struct NTTInfo {
+    static constexpr int root = ntt_primitive_root(MOD);
+    static constexpr int max_log = root == 0 ? 0 : ntt_max_log(MOD);
+};
+
+// In-place transform of a power-of-two length vector (inverse transform if invert is set).
+template<int MOD>
+void ntt(vector<ModInt<MOD>>& a, bool invert) {
+    typedef ModInt<MOD> Mint;
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            swap(a[i], a[j]);
+    }
+    vector<Mint> w(max<size_t>(1, n / 2));
+    bool parallel = parallel_worthwhile(n, NTT_PARALLEL_MIN);
+    for (size_t len = 2, log_half = 0; len <= n; len <<= 1, log_half++) {
+        Mint wlen = Mint(NTTInfo<MOD>::root).pow((MOD - 1) / (long long)len);
+        if(invert)
+            wlen = wlen.inv();
+        size_t half = len / 2;
+        w[0] = Mint(1);
+        for (size_t j = 1; j < half; j++)
+            w[j] = w[j-1] * wlen;
+        if(parallel) {
+            // Butterfly t of the stage is pair j = t % half of block t / half.
+            parallel_for(0, n / 2, NTT_PARALLEL_GRAIN, [&](size_t lo, size_t hi) {
+                for (size_t t = lo; t < hi; t++) {
+                    size_t j = t & (half - 1), i = ((t >> log_half) << (log_half + 1)) + j;
+                    Mint u = a[i];
+                    Mint v = a[i+half] * w[j];
+                    a[i] = u + v;
+                    a[i+half] = u - v;
+                }
+            });
+            continue;
+        }
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < half; j++) {
+                Mint u = a[i+j];
+                Mint v = a[i+j+half] * w[j];
+                a[i+j] = u + v;
+                a[i+j+half] = u - v;
+            }
+        }
+    }
+    if(invert) {
+        Mint n_inv = Mint((int)(n % MOD)).inv();
+        for (auto &x : a)
+            x *= n_inv;
+    }
+}
+
+// Smallest power of two >= n.
+inline size_t ntt_size(size_t n) {
+    size_t size = 1;
+    while(size < n)
+        size <<= 1;
+    return size;
+}
+
+// Whether ModInt<MOD> vectors of the given length can be transformed directly.
+template<int MOD>
+bool ntt_supports(size_t length) {
+    return NTTInfo<MOD>::max_log > 0 && length <= ((size_t)1 << NTTInfo<MOD>::max_log);
+}
+
+// Cyclic-free product over an NTT-friendly prime. Squaring transforms only once.
+template<int MOD>
+vector<ModInt<MOD>> convolve_ntt(const vector<ModInt<MOD>>& a, const vector<ModInt<MOD>>& b) {
+    size_t need = a.size() + b.size() - 1;
+    size_t n = ntt_size(need);
+    vector<ModInt<MOD>> fa(a.begin(), a.end());
+    fa.resize(n, ModInt<MOD>(0));
+    if(&a == &b) {
+        ntt(fa, false);
+        for (size_t i = 0; i < n; i++)
+            fa[i] *= fa[i];
+    } else {
+        vector<ModInt<MOD>> fb(b.begin(), b.end());
+        fb.resize(n, ModInt<MOD>(0));
+        if(parallel_worthwhile(n, NTT_PARALLEL_MIN))
+            parallel_invoke([&] { ntt(fa, false); }, [&] { ntt(fb, false); });
+        else {
+            ntt(fa, false);
+            ntt(fb, false);
+        }
+        for (size_t i = 0; i < n; i++)
+            fa[i] *= fb[i];
+    }
+    ntt(fa, true);
+    fa.resize(need);
+    return fa;
+}
+
+// NTT-friendly primes below 2^30, largest first. Each supports transforms up to 2^23, so
+// products of any modulus are computed exactly over enough of them and recombined by CRT.
+inline constexpr int NTT_PRIMES[] = {
+    998244353, 897581057, 880803841, 754974721, 645922817,
+    595591169, 469762049, 377487361, 167772161
+};
+inline constexpr int NTT_PRIME_COUNT = 9;
+inline constexpr int NTT_CRT_MAX_LOG = 23;
+
+// Convolves nonnegative residues as coefficients modulo the prime P.
+template<int P>
+vector<uint64_t> convolve_residues(const vector<uint64_t>& a, const vector<uint64_t>& b) {
+    vector<ModInt<P>> fa(a.size()), fb(b.size());
+    for (size_t i = 0; i < a.size(); i++)
+        fa[i] = ModInt<P>((long long)(a[i] % P));
+    for (size_t i = 0; i < b.size(); i++)
+        fb[i] = ModInt<P>((long long)(b[i] % P));
+    auto prod = &a == &b ? convolve_ntt<P>(fa, fa) : convolve_ntt<P>(fa, fb);
+    vector<uint64_t> res(prod.size());
+    for (size_t i = 0; i < res.size(); i++)
+        res[i] = prod[i].value;
+    return res;
+}
+
+inline vector<uint64_t> convolve_residues_by_index(int idx, const vector<uint64_t>& a,
+                                                   const vector<uint64_t>& b) {
+    switch(idx) {
+        case 0: return convolve_residues<NTT_PRIMES[0]>(a, b);
+        case 1: return convolve_residues<NTT_PRIMES[1]>(a, b);
+        case 2: return convolve_residues<NTT_PRIMES[2]>(a, b);
+        case 3: return convolve_residues<NTT_PRIMES[3]>(a, b);
+        case 4: return convolve_residues<NTT_PRIMES[4]>(a, b);
+        case 5: return convolve_residues<NTT_PRIMES[5]>(a, b);
+        case 6: return convolve_residues<NTT_PRIMES[6]>(a, b);
+        case 7: return convolve_residues<NTT_PRIMES[7]>(a, b);
+        case 8: return convolve_residues<NTT_PRIMES[8]>(a, b);
+    }
+    throw out_of_range("NTT prime index out of range");
+}
+
+// Number of primes whose product exceeds every coefficient of a product of length len
+// with coefficients below bound_a and bound_b, or 0 if the prime list is too short.
+inline int crt_primes_needed(size_t len, uint64_t bound_a, uint64_t bound_b) {
+    double bits = log2((double)len) + log2((double)max<uint64_t>(bound_a, 1))
+                + log2((double)max<uint64_t>(bound_b, 1)) + 1;
+    double have = 0;
+    for (int i = 0; i < NTT_PRIME_COUNT; i++) {
+        have += log2((double)NTT_PRIMES[i]);
+        if(have > bits)
+            return i + 1;
+    }
+    return 0;
+}
+
+// Whether convolve_crt can handle a product of this length and modulus.
+inline bool crt_supports(size_t len, uint64_t mod) {
+    return len <= ((size_t)1 << NTT_CRT_MAX_LOG) && crt_primes_needed(len, mod, mod) > 0;
+}
+
+// Product of residue vectors modulo mod (any modulus below 2^63): the exact integer
+// convolution is computed over several NTT primes and recombined with Garner's algorithm.
+inline vector<uint64_t> convolve_crt(const vector<uint64_t>& a, const vector<uint64_t>& b, uint64_t mod) {
+    size_t len = a.size() + b.size() - 1;
+    int k = crt_primes_needed(len, mod, mod);
+    if(k == 0 || len > ((size_t)1 << NTT_CRT_MAX_LOG))
+        throw length_error("Product too large for the NTT prime set");
+    vector<vector<uint64_t>> residues(k);
+    // One task per prime for long products; each one also parallelizes its transforms.
+    // Short products call the loops directly, so they never start the shared pool.
+    bool parallel = parallel_worthwhile(len, NTT_PARALLEL_MIN);
+    auto transform = [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+            residues[i] = &a == &b ? convolve_residues_by_index(i, a, a) : convolve_residues_by_index(i, a, b);
+    };
+    if(parallel)
+        parallel_for(0, k, 1, transform);
+    else
+        transform(0, k);
+    // inv[j][i] = p_j^(-1) mod p_i for j < i.
+    vector<vector<uint64_t>> inv(k, vector<uint64_t>(k, 0));
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < i; j++)
+            inv[j][i] = ntt_pow_mod(NTT_PRIMES[j] % NTT_PRIMES[i], NTT_PRIMES[i] - 2, NTT_PRIMES[i]);
+    vector<uint64_t> radix(k); // p_0 * ... * p_(i-1) mod mod
+    radix[0] = 1 % mod;
+    for (int i = 1; i < k; i++)
+        radix[i] = (uint64_t)((unsigned __int128)radix[i-1] * NTT_PRIMES[i-1] % mod);
+    vector<uint64_t> res(len);
+    auto recombine = [&](size_t lo, size_t hi) {
+        vector<uint64_t> digits(k);
+        for (size_t t = lo; t < hi; t++) {
+            // Mixed-radix digits of the coefficient, then its value modulo mod.
+            unsigned __int128 acc = 0;
+            for (int i = 0; i < k; i++) {
+                uint64_t p = NTT_PRIMES[i];
+                uint64_t x = residues[i][t];
+                for (int j = 0; j < i; j++)
+                    x = (x + p - digits[j] % p) % p * inv[j][i] % p;
+                digits[i] = x;
+                acc = (acc + (unsigned __int128)x * radix[i]) % mod;
+            }
+            res[t] = (uint64_t)acc;
+        }
+    };
+    if(parallel)
+        parallel_for(0, len, NTT_PARALLEL_GRAIN, recombine);
+    else
+        recombine(0, len);
+    return res;
+}
+
+// Product of modular coefficients T (providing static mod() and val()) through convolve_crt.
+template<typename T>
+vector<T> convolve_crt_modular(const vector<T>& a, const vector<T>& b) {
+    vector<uint64_t> ra(a.size()), rb(b.size());
+    for (size_t i = 0; i < a.size(); i++)
+        ra[i] = a[i].val();
+    for (size_t i = 0; i < b.size(); i++)
+        rb[i] = b[i].val();
+    auto prod = &a == &b ? convolve_crt(ra, ra, T::mod()) : convolve_crt(ra, rb, T::mod());
+    vector<T> res(prod.size());
+    for (size_t i = 0; i < res.size(); i++)
+        res[i] = T((long long)prod[i]);
+    return res;
+}
+
+// ModInt<MOD> product: schoolbook for tiny operands, Karatsuba for medium ones,
+// and a transform for long operands.
+template<int MOD>
+vector<ModInt<MOD>> convolve(const vector<ModInt<MOD>>& a, const vector<ModInt<MOD>>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    size_t shorter = min(a.size(), b.size());
+    size_t need = a.size() + b.size() - 1;
+    if(shorter <= KARATSUBA_THRESHOLD) {
+        vector<ModInt<MOD>> res(need, ModInt<MOD>(0));
+        convolve_schoolbook_add(a.data(), a.size(), b.data(), b.size(), res.data());
+        return res;
+    }
+    if(shorter >= NTT_THRESHOLD && ntt_supports<MOD>(need))
+        return convolve_ntt(a, b);
+    if(shorter >= NTT_CRT_THRESHOLD && crt_supports(need, MOD))
+        return convolve_crt_modular(a, b);
+    return convolve_karatsuba(a, b);
+}
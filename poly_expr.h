@@ -0,0 +1,212 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include "polynomial.h"
+
+using namespace std;
+
+//////////////////////////////
+// poly_expr.h
+//////////////////////////////
+
+// Lazy sums of polynomials and products for accumulate-heavy code. lazy(p) starts an
+// expression; +, - and * with further polynomials extend it, and nothing is computed until
+// the expression is assigned to (or accumulated into) a Polynomial:
+//
+//   dest = lazy(a) * b + lazy(c) * d - e;   // one pass, reusing dest's buffer
+//   acc += lazy(a) * b;                     // no intermediate Polynomial
+//
+// The destination is sized once for the whole expression, then every term is added or
+// subtracted into it in place. Products with a short operand accumulate straight into the
+// destination; longer ones go through convolve() (Karatsuba, NTT or FFT), whose single
+// product buffer is the only temporary. An expression holds references to its operands,
+// so it must be consumed before they go out of scope (normally in the same statement).
+// If the destination also appears in the expression, the result is built aside first.
+
+// CRTP base of all expression nodes. A node E provides value_type, size() (an upper bound
+// on the result length), aliases(p) and accumulate(out, negate), which adds (or subtracts)
+// its value into out[0 .. size()).
+template<typename E>
+struct PolyExpr {
+    const E& self() const {
+        return static_cast<const E&>(*this);
+    }
+};
+
+template<typename T>
+struct PolyRef : PolyExpr<PolyRef<T>> {
+    typedef T value_type;
+    const Polynomial<T>& p;
+
+    explicit PolyRef(const Polynomial<T>& p) : p(p) {}
+
+    size_t size() const {
+        return p.coeffs.size();
+    }
+    bool aliases(const Polynomial<T>* dest) const {
+        return &p == dest;
+    }
+    void accumulate(T* out, bool negate) const {
+        const vector<T>& c = p.coeffs;
+        if(negate) {
+            for (size_t i = 0; i < c.size(); i++)
+                out[i] = out[i] - c[i];
+        } else {
+            for (size_t i = 0; i < c.size(); i++)
+                out[i] = out[i] + c[i];
+        }
+    }
+};
+
+template<typename T>
+struct PolyProduct : PolyExpr<PolyProduct<T>> {
+    typedef T value_type;
+    const Polynomial<T>& a;
+    const Polynomial<T>& b;
+
+    PolyProduct(const Polynomial<T>& a, const Polynomial<T>& b) : a(a), b(b) {}
+
+    size_t size() const {
+        if(a.coeffs.empty() || b.coeffs.empty())
+            return 0;
+        return a.coeffs.size() + b.coeffs.size() - 1;
+    }
+    bool aliases(const Polynomial<T>* dest) const {
+        return &a == dest || &b == dest;
+    }
+    void accumulate(T* out, bool negate) const {
+        PROFILE_SCOPE(PolyMul);
+        size_t n = a.coeffs.size(), m = b.coeffs.size();
+        if(n == 0 || m == 0)
+            return;
+        const T* x = a.coeffs.data();
+        const T* y = b.coeffs.data();
+        if(min(n, m) <= KARATSUBA_THRESHOLD) {
+            if(!negate) {
+                convolve_schoolbook_add(x, n, y, m, out);
+                return;
+            }
+            for (size_t i = 0; i < n; i++)
+                for (size_t j = 0; j < m; j++)
+                    out[i+j] = out[i+j] - x[i] * y[j];
+            return;
+        }
+        vector<T> prod = convolve(a.coeffs, b.coeffs);
+        for (size_t i = 0; i < prod.size(); i++)
+            out[i] = negate ? out[i] - prod[i] : out[i] + prod[i];
+    }
+};
+
+// l + r, or l - r when Subtract is set.
+template<typename L, typename R, bool Subtract>
+struct PolySum : PolyExpr<PolySum<L, R, Subtract>> {
+    typedef typename L::value_type value_type;
+    L l;
+    R r;
+
+    PolySum(const L& l, const R& r) : l(l), r(r) {}
+
+    size_t size() const {
+        return max(l.size(), r.size());
+    }
+    bool aliases(const Polynomial<value_type>* dest) const {
+        return l.aliases(dest) || r.aliases(dest);
+    }
+    void accumulate(value_type* out, bool negate) const {
+        l.accumulate(out, negate);
+        r.accumulate(out, negate != Subtract);
+    }
+};
+
+// Starts a lazy expression.
+template<typename T>
+PolyRef<T> lazy(const Polynomial<T>& p) {
+    return PolyRef<T>(p);
+}
+
+template<typename T>
+PolyProduct<T> operator*(const PolyRef<T>& a, const Polynomial<T>& b) {
+    return PolyProduct<T>(a.p, b);
+}
+template<typename T>
+PolyProduct<T> operator*(const PolyRef<T>& a, const PolyRef<T>& b) {
+    return PolyProduct<T>(a.p, b.p);
+}
+
+template<typename L, typename R>
+PolySum<L, R, false> operator+(const PolyExpr<L>& l, const PolyExpr<R>& r) {
+    return PolySum<L, R, false>(l.self(), r.self());
+}
+template<typename L, typename R>
+PolySum<L, R, true> operator-(const PolyExpr<L>& l, const PolyExpr<R>& r) {
+    return PolySum<L, R, true>(l.self(), r.self());
+}
+template<typename L, typename T>
+PolySum<L, PolyRef<T>, false> operator+(const PolyExpr<L>& l, const Polynomial<T>& r) {
+    return PolySum<L, PolyRef<T>, false>(l.self(), PolyRef<T>(r));
+}
+template<typename L, typename T>
+PolySum<L, PolyRef<T>, true> operator-(const PolyExpr<L>& l, const Polynomial<T>& r) {
+    return PolySum<L, PolyRef<T>, true>(l.self(), PolyRef<T>(r));
+}
+template<typename T, typename R>
+PolySum<PolyRef<T>, R, false> operator+(const Polynomial<T>& l, const PolyExpr<R>& r) {
+    return PolySum<PolyRef<T>, R, false>(PolyRef<T>(l), r.self());
+}
+template<typename T, typename R>
+PolySum<PolyRef<T>, R, true> operator-(const Polynomial<T>& l, const PolyExpr<R>& r) {
+    return PolySum<PolyRef<T>, R, true>(PolyRef<T>(l), r.self());
+}
+
+template<typename T>
+template<typename E>
+Polynomial<T>& Polynomial<T>::assign(const PolyExpr<E>& expr) {
+    const E& e = expr.self();
+    if(e.aliases(this)) {
+        Polynomial result;
+        result.assign(expr);
+        coeffs.swap(result.coeffs);
+        return *this;
+    }
+    if(e.size() > coeffs.capacity())
+        PROFILE_ALLOC(e.size() * sizeof(T));
+    coeffs.assign(e.size(), T(0)); // keeps the capacity of the old buffer
+    e.accumulate(coeffs.data(), false);
+    normalize();
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+Polynomial<T>& Polynomial<T>::operator+=(const PolyExpr<E>& expr) {
+    const E& e = expr.self();
+    if(e.aliases(this))
+        return *this += Polynomial(expr);
+    if(coeffs.size() < e.size()) {
+        if(e.size() > coeffs.capacity())
+            PROFILE_ALLOC(e.size() * sizeof(T));
+        coeffs.resize(e.size(), T(0));
+    }
+    e.accumulate(coeffs.data(), false);
+    normalize();
+    return *this;
+}
+
+template<typename T>
+template<typename E>
+Polynomial<T>& Polynomial<T>::operator-=(const PolyExpr<E>& expr) {
+    const E& e = expr.self();
+    if(e.aliases(this))
+        return *this -= Polynomial(expr);
+    if(coeffs.size() < e.size()) {
+        if(e.size() > coeffs.capacity())
+            PROFILE_ALLOC(e.size() * sizeof(T));
+        coeffs.resize(e.size(), T(0));
+    }
+    e.accumulate(coeffs.data(), true);
+    normalize();
+    return *this;
+}
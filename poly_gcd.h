@@ -0,0 +1,179 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <tuple>
+#include <algorithm>
+#include "polynomial.h"
+
+using namespace std;
+
+//////////////////////////////
+// poly_gcd.h
+//////////////////////////////
+
+// Greatest common divisors over a field. Small inputs run an iterative Euclid on a few
+// reused buffers; large ones use the half-GCD recursion, which jumps over half of the
+// remainder sequence with O(log n) multiplications of shrinking size and keeps the
+// stack depth logarithmic in the degree.
+
+// Above this degree the half-GCD recursion replaces plain Euclidean steps.
+inline constexpr int HGCD_THRESHOLD = 128;
+
+// 2x2 matrix of polynomials acting on remainder pairs:
+// (a, b) -> (m00 * a + m01 * b, m10 * a + m11 * b).
+template<typename T>
+struct PolyMatrix {
+    Polynomial<T> m00, m01, m10, m11;
+
+    static PolyMatrix identity() {
+        return {Polynomial<T>(T(1)), Polynomial<T>(), Polynomial<T>(), Polynomial<T>(T(1))};
+    }
+
+    PolyMatrix operator*(const PolyMatrix& o) const {
+        return {m00 * o.m00 + m01 * o.m10, m00 * o.m01 + m01 * o.m11,
+                m10 * o.m00 + m11 * o.m10, m10 * o.m01 + m11 * o.m11};
+    }
+
+    pair<Polynomial<T>, Polynomial<T>> apply(const Polynomial<T>& a, const Polynomial<T>& b) const {
+        return {m00 * a + m01 * b, m10 * a + m11 * b};
+    }
+
+    // Left-multiplies by the Euclidean step [[0, 1], [1, -q]].
+    void push_quotient(const Polynomial<T>& q) {
+        Polynomial<T> n10 = m00 - q * m10;
+        Polynomial<T> n11 = m01 - q * m11;
+        m00 = move(m10);
+        m01 = move(m11);
+        m10 = move(n10);
+        m11 = move(n11);
+    }
+};
+
+// The polynomial divided by x^k, dropping the low k coefficients.
+template<typename T>
+Polynomial<T> shift_down(const Polynomial<T>& p, int k) {
+    if(k >= (int)p.coeffs.size())
+        return Polynomial<T>();
+    return Polynomial<T>(vector<T>(p.coeffs.begin() + k, p.coeffs.end()));
+}
+
+// Half-GCD for deg a > deg b: returns the matrix M of the Euclidean steps that take (a, b)
+// to the consecutive remainders (c, d) = M (a, b) with deg c >= ceil(deg a / 2) > deg d.
+template<typename T>
+PolyMatrix<T> half_gcd(const Polynomial<T>& a, const Polynomial<T>& b) {
+    int m = (a.degree() + 1) / 2;
+    if(b.degree() < m)
+        return PolyMatrix<T>::identity();
+    if(a.degree() <= HGCD_THRESHOLD) {
+        PolyMatrix<T> r = PolyMatrix<T>::identity();
+        Polynomial<T> x = a, y = b;
+        while(y.degree() >= m) {
+            auto [q, rem] = x.divmod(y);
+            x = move(y);
+            y = move(rem);
+            r.push_quotient(q);
+        }
+        return r;
+    }
+    // The high halves determine the first half of the quotient sequence.
+    PolyMatrix<T> r = half_gcd(shift_down(a, m), shift_down(b, m));
+    auto [x, y] = r.apply(a, b);
+    if(y.degree() < m)
+        return r;
+    auto [q, rem] = x.divmod(y);
+    x = move(y);
+    y = move(rem);
+    r.push_quotient(q);
+    if(y.degree() < m)
+        return r;
+    int k = 2 * m - x.degree();
+    return half_gcd(shift_down(x, k), shift_down(y, k)) * r;
+}
+
+// dst -= c * x^k * src, growing dst as needed and trimming its zero top coefficients.
+template<typename T>
+void sub_shifted(vector<T>& dst, const vector<T>& src, const T& c, int k) {
+    if(dst.size() < src.size() + k)
+        dst.resize(src.size() + k, T(0));
+    for (size_t j = 0; j < src.size(); j++)
+        dst[j+k] = dst[j+k] - c * src[j];
+    while(!dst.empty() && dst.back() == T(0))
+        dst.pop_back();
+}
+
+// Iterative extended Euclid: returns (g, x, y) with a*x + b*y == g == gcd(a, b) (not monic).
+// Each division runs in place on the remainder buffer and updates the cofactors term by
+// term, so no quotient polynomial is built.
+template<typename T>
+tuple<Polynomial<T>, Polynomial<T>, Polynomial<T>> extended_gcd_iterative(
+    const Polynomial<T>& a, const Polynomial<T>& b)
+{
+    vector<T> r0 = a.coeffs, r1 = b.coeffs;
+    vector<T> s0 = {T(1)}, s1, t0, t1 = {T(1)};
+    while(!r1.empty()) {
+        int d1 = r1.size() - 1;
+        T lead_inv = T(1) / r1.back();
+        while((int)r0.size() - 1 >= d1) {
+            int k = r0.size() - 1 - d1;
+            T c = r0.back() * lead_inv;
+            for (int j = 0; j < d1; j++)
+                r0[j+k] = r0[j+k] - c * r1[j];
+            r0.pop_back(); // the leading term cancels
+            while(!r0.empty() && r0.back() == T(0))
+                r0.pop_back();
+            sub_shifted(s0, s1, c, k);
+            sub_shifted(t0, t1, c, k);
+        }
+        swap(r0, r1);
+        swap(s0, s1);
+        swap(t0, t1);
+    }
+    return {Polynomial<T>(r0), Polynomial<T>(s0), Polynomial<T>(t0)};
+}
+
+// Extended gcd: returns (g, x, y) with a*x + b*y == g == gcd(a, b) (not monic).
+template<typename T>
+tuple<Polynomial<T>, Polynomial<T>, Polynomial<T>> poly_extended_gcd(
+    const Polynomial<T>& a, const Polynomial<T>& b)
+{
+    PolyMatrix<T> m = PolyMatrix<T>::identity();
+    Polynomial<T> x = a, y = b;
+    while(y.degree() >= 0) {
+        if(x.degree() <= HGCD_THRESHOLD) {
+            // g = s x + t y, and (x, y) = m (a, b).
+            auto [g, s, t] = extended_gcd_iterative(x, y);
+            return {g, s * m.m00 + t * m.m10, s * m.m01 + t * m.m11};
+        }
+        if(x.degree() > y.degree()) {
+            PolyMatrix<T> h = half_gcd(x, y);
+            tie(x, y) = h.apply(x, y);
+            m = h * m;
+            if(y.degree() < 0)
+                break;
+        }
+        auto [q, rem] = x.divmod(y);
+        x = move(y);
+        y = move(rem);
+        m.push_quotient(q);
+    }
+    return {x, m.m00, m.m01};
+}
+
+// Monic greatest common divisor. Large inputs skip through the remainder sequence with
+// half-GCD steps without tracking cofactors for the caller.
+template<typename T>
+Polynomial<T> poly_gcd(Polynomial<T> a, Polynomial<T> b) {
+    while(b.degree() >= 0) {
+        if(a.degree() > HGCD_THRESHOLD && a.degree() > b.degree()) {
+            tie(a, b) = half_gcd(a, b).apply(a, b);
+            if(b.degree() < 0)
+                break;
+        }
+        Polynomial<T> r = a % b;
+        a = move(b);
+        b = move(r);
+    }
+    return make_monic(a);
+}
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include "polynomial.h"
+#include "modint.h"
+#include "dynmodint.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define POLY_IO_MMAP 1
+#endif
+
+using namespace std;
+
+//////////////////////////////
+// poly_io.h
+//////////////////////////////
+
+// Binary file format for polynomials. All fields are little-endian:
+//
+//   offset  size  field
+//        0     4  magic "PLYC"
+//        4     2  format version (POLY_FORMAT_VERSION)
+//        6     1  coefficient type (CoeffType)
+//        7     1  reserved (0)
+//        8     8  modulus (0 for real coefficients)
+//       16     8  number of coefficients (degree + 1; 0 for the zero polynomial)
+//       24     8  reserved (0)
+//       32        coefficients, constant term first, packed
+//
+// Residues are stored in [0, modulus). The coefficient block starts 8-byte aligned, so a
+// mapped file can be read in place: PolynomialView maps it read-only and, on a
+// little-endian host, hands out the stored coefficients without copying them.
+// PolynomialWriter streams coefficients to a file without building a Polynomial first.
+
+inline constexpr char POLY_FORMAT_MAGIC[4] = {'P', 'L', 'Y', 'C'};
+inline constexpr uint16_t POLY_FORMAT_VERSION = 1;
+inline constexpr size_t POLY_HEADER_SIZE = 32;
+
+enum class CoeffType : uint8_t { Float64 = 1, Residue32 = 2, Residue64 = 3 };
+
+// How a coefficient type is stored: the packed representation, its tag and the modulus.
+template<typename T>
+struct CoeffFormat;
+
+template<>
+struct CoeffFormat<double> {
+    typedef double Stored;
+    static constexpr CoeffType type = CoeffType::Float64;
+    static uint64_t modulus() { return 0; }
+    static Stored store(double v) { return v; }
+    static double load(Stored s) { return s; }
+};
+
+template<int MOD>
+struct CoeffFormat<ModInt<MOD>> {
+    typedef uint32_t Stored;
+    static constexpr CoeffType type = CoeffType::Residue32;
+    static uint64_t modulus() { return MOD; }
+    static Stored store(const ModInt<MOD>& v) { return v.val(); }
+    static ModInt<MOD> load(Stored s) { return ModInt<MOD>((long long)s); }
+};
+
+template<int ID>
+struct CoeffFormat<DynModInt<ID>> {
+    typedef uint64_t Stored;
+    static constexpr CoeffType type = CoeffType::Residue64;
+    static uint64_t modulus() { return DynModInt<ID>::mod(); }
+    static Stored store(const DynModInt<ID>& v) { return v.val(); }
+    static DynModInt<ID> load(Stored s) { return DynModInt<ID>(s); }
+};
+
+template<typename U>
+U to_little_endian(U v) {
+    if constexpr (endian::native == endian::little) {
+        return v;
+    } else {
+        U r;
+        unsigned char* src = (unsigned char*)&v;
+        unsigned char* dst = (unsigned char*)&r;
+        for (size_t i = 0; i < sizeof(U); i++)
+            dst[i] = src[sizeof(U) - 1 - i];
+        return r;
+    }
+}
+
+struct PolyFileHeader {
+    CoeffType type;
+    uint64_t modulus;
+    uint64_t count;
+};
+
+inline void encode_header(unsigned char* out, const PolyFileHeader& h) {
+    memset(out, 0, POLY_HEADER_SIZE);
+    memcpy(out, POLY_FORMAT_MAGIC, 4);
+    uint16_t version = to_little_endian(POLY_FORMAT_VERSION);
+    uint64_t modulus = to_little_endian(h.modulus), count = to_little_endian(h.count);
+    memcpy(out + 4, &version, 2);
+    out[6] = (unsigned char)h.type;
+    memcpy(out + 8, &modulus, 8);
+    memcpy(out + 16, &count, 8);
+}
+
+// Checks the header against the coefficient type T and the current modulus.
+template<typename T>
+PolyFileHeader decode_header(const unsigned char* in, size_t file_size) {
+    typedef CoeffFormat<T> Format;
+    if(file_size < POLY_HEADER_SIZE || memcmp(in, POLY_FORMAT_MAGIC, 4) != 0)
+        throw runtime_error("Not a polynomial file");
+    uint16_t version;
+    memcpy(&version, in + 4, 2);
+    if(to_little_endian(version) != POLY_FORMAT_VERSION)
+        throw runtime_error("Unsupported polynomial file version " + to_string(to_little_endian(version)));
+    PolyFileHeader h;
+    h.type = (CoeffType)in[6];
+    memcpy(&h.modulus, in + 8, 8);
+    memcpy(&h.count, in + 16, 8);
+    h.modulus = to_little_endian(h.modulus);
+    h.count = to_little_endian(h.count);
+    if(h.type != Format::type)
+        throw runtime_error("Polynomial file has a different coefficient type");
+    if(h.modulus != Format::modulus())
+        throw runtime_error("Polynomial file uses modulus " + to_string(h.modulus)
+                            + ", expected " + to_string(Format::modulus()));
+    if(h.count > (file_size - POLY_HEADER_SIZE) / sizeof(typename Format::Stored))
+        throw runtime_error("Polynomial file is truncated");
+    return h;
+}
+
+// Read-only view of a polynomial file. The file is memory-mapped; on little-endian hosts
+// the coefficients are read straight from the mapping.
+template<typename T>
+class PolynomialView {
+public:
+    typedef typename CoeffFormat<T>::Stored Stored;
+
+    explicit PolynomialView(const string& path) {
+#ifdef POLY_IO_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            throw runtime_error("Cannot open " + path);
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("Cannot stat " + path);
+        }
+        map_size = st.st_size;
+        if(map_size > 0) {
+            void* p = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if(p == MAP_FAILED)
+                throw runtime_error("Cannot map " + path);
+            mapping = (const unsigned char*)p;
+        } else {
+            close(fd);
+        }
+        const unsigned char* bytes = mapping;
+#else
+        FILE* f = fopen(path.c_str(), "rb");
+        if(!f)
+            throw runtime_error("Cannot open " + path);
+        vector<unsigned char> contents;
+        unsigned char chunk[1 << 16];
+        size_t got;
+        while((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+            contents.insert(contents.end(), chunk, chunk + got);
+        fclose(f);
+        map_size = contents.size();
+        const unsigned char* bytes = contents.data();
+#endif
+        try {
+            header = decode_header<T>(bytes, map_size);
+        } catch (...) {
+            release();
+            throw;
+        }
+        const unsigned char* block = bytes + POLY_HEADER_SIZE;
+#ifdef POLY_IO_MMAP
+        if constexpr (endian::native == endian::little) {
+            data = (const Stored*)block;
+            return;
+        }
+#endif
+        owned.resize(header.count);
+        memcpy(owned.data(), block, header.count * sizeof(Stored));
+        for (auto &s : owned)
+            s = to_little_endian(s);
+        data = owned.data();
+        release();
+    }
+
+    PolynomialView(const PolynomialView&) = delete;
+    PolynomialView& operator=(const PolynomialView&) = delete;
+    ~PolynomialView() {
+        release();
+    }
+
+    size_t size() const {
+        return header.count;
+    }
+    int degree() const {
+        return (int)header.count - 1;
+    }
+    uint64_t modulus() const {
+        return header.modulus;
+    }
+    // Whether the coefficients are read in place from the mapped file (not copied).
+    bool mapped() const {
+        return mapping != nullptr;
+    }
+    // The stored coefficients (residues for modular types), constant term first.
+    span<const Stored> raw() const {
+        return span<const Stored>(data, header.count);
+    }
+    T operator[](size_t i) const {
+        return CoeffFormat<T>::load(data[i]);
+    }
+
+    // Horner evaluation straight from the file.
+    T evaluate(const T& x) const {
+        T result = T(0);
+        for (size_t i = header.count; i-- > 0;)
+            result = result * x + (*this)[i];
+        return result;
+    }
+
+    Polynomial<T> to_polynomial() const {
+        vector<T> coeffs;
+        coeffs.reserve(header.count);
+        for (size_t i = 0; i < header.count; i++)
+            coeffs.push_back((*this)[i]);
+        return Polynomial<T>(move(coeffs));
+    }
+
+private:
+    PolyFileHeader header{};
+    const unsigned char* mapping = nullptr;
+    size_t map_size = 0;
+    vector<Stored> owned; // Used when the mapping cannot be read in place.
+    const Stored* data = nullptr;
+
+    void release() {
+#ifdef POLY_IO_MMAP
+        if(mapping)
+            munmap((void*)mapping, map_size);
+#endif
+        mapping = nullptr;
+    }
+};
+
+// Streaming writer: coefficients are appended in order (constant term first) and the
+// header is completed on close(). Packed output goes through a fixed buffer, and spans of
+// doubles are written straight from the caller's memory on little-endian hosts.
+template<typename T>
+class PolynomialWriter {
+public:
+    typedef typename CoeffFormat<T>::Stored Stored;
+
+    explicit PolynomialWriter(const string& path) : path(path) {
+        file = fopen(path.c_str(), "wb");
+        if(!file)
+            throw runtime_error("Cannot open " + path);
+        unsigned char header[POLY_HEADER_SIZE];
+        encode_header(header, {CoeffFormat<T>::type, CoeffFormat<T>::modulus(), 0});
+        if(fwrite(header, 1, POLY_HEADER_SIZE, file) != POLY_HEADER_SIZE)
+            fail();
+        buf.reserve(BUFFER_SIZE);
+    }
+    PolynomialWriter(const PolynomialWriter&) = delete;
+    PolynomialWriter& operator=(const PolynomialWriter&) = delete;
+    ~PolynomialWriter() {
+        if(file)
+            fclose(file);
+    }
+
+    void push(const T& c) {
+        buf.push_back(to_little_endian(CoeffFormat<T>::store(c)));
+        count++;
+        if(buf.size() == BUFFER_SIZE)
+            flush_buffer();
+    }
+
+    void append(span<const T> coeffs) {
+        if constexpr (is_same_v<T, double> && endian::native == endian::little) {
+            flush_buffer();
+            if(fwrite(coeffs.data(), sizeof(double), coeffs.size(), file) != coeffs.size())
+                fail();
+            count += coeffs.size();
+        } else {
+            for (const T& c : coeffs)
+                push(c);
+        }
+    }
+
+    // Finishes the file. Trailing zero coefficients are the caller's responsibility.
+    void close() {
+        flush_buffer();
+        unsigned char header[POLY_HEADER_SIZE];
+        encode_header(header, {CoeffFormat<T>::type, CoeffFormat<T>::modulus(), count});
+        if(fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, POLY_HEADER_SIZE, file) != POLY_HEADER_SIZE)
+            fail();
+        int status = fclose(file);
+        file = nullptr;
+        if(status != 0)
+            throw runtime_error("I/O error while writing " + path);
+    }
+
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 14;
+    string path;
+    FILE* file = nullptr;
+    vector<Stored> buf;
+    uint64_t count = 0;
+
+    void flush_buffer() {
+        if(!buf.empty() && fwrite(buf.data(), sizeof(Stored), buf.size(), file) != buf.size())
+            fail();
+        buf.clear();
+    }
+    [[noreturn]] void fail() {
+        fclose(file);
+        file = nullptr;
+        throw runtime_error("I/O error while writing " + path);
+    }
+};
+
+template<typename T>
+void write_polynomial(const string& path, const Polynomial<T>& p) {
+    PolynomialWriter<T> writer(path);
+    writer.append(span<const T>(p.coeffs));
+    writer.close();
+}
+
+template<typename T>
+Polynomial<T> load_polynomial(const string& path) {
+    return PolynomialView<T>(path).to_polynomial();
+}
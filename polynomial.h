@@ -5,6 +5,11 @@
 #include <stdexcept>
 #include <tuple>
 #include <algorithm>
+#include <span>
+#include "convolution.h"
+#include "ntt.h"
+#include "fft.h"
+#include "profile.h"
 
 
 using namespace std;
@@ -13,6 +18,13 @@ using namespace std;
 // polynomial.h
 //////////////////////////////
 
+// Divisions where both the divisor degree and the quotient length exceed this
+// use Newton iteration instead of schoolbook long division.
+inline constexpr int DIVISION_NEWTON_THRESHOLD = 64;
+
+template<typename E>
+struct PolyExpr; // Base of the lazy sum/product expressions in poly_expr.h.
+
 // Template class for representing a polynomial with coefficients of type T.
 // The polynomial is stored as a vector of coefficients where coeffs[i] corresponds to x^i.
 template<typename T>
@@ -22,6 +34,13 @@ public:
     
     Polynomial() {}
     Polynomial(const vector<T>& c): coeffs(c) {
+        PROFILE_ALLOC(c.size() * sizeof(T));
+        normalize();
+    }
+    // Takes over the buffer of a temporary vector without copying it. The buffer was
+    // allocated for this polynomial (by a product, sum, ...), so it is counted here.
+    Polynomial(vector<T>&& c): coeffs(move(c)) {
+        PROFILE_ALLOC(coeffs.size() * sizeof(T));
         normalize();
     }
     // Constructor for a constant polynomial.
@@ -31,6 +50,7 @@ public:
     
     // Remove trailing zero coefficients.
     void normalize(){
+        PROFILE_SCOPE(PolyNormalize);
         while(!coeffs.empty() && coeffs.back() == T(0))
             coeffs.pop_back();
     }
@@ -45,80 +65,125 @@ public:
         return (idx < 0 || idx >= (int)coeffs.size()) ? T(0) : coeffs[idx];
     }
     
-    // Addition.
-    Polynomial operator+(const Polynomial& other) const {
-        vector<T> result(max(coeffs.size(), other.coeffs.size()), T(0));
-        for (size_t i = 0; i < result.size(); i++) {
-            if (i < coeffs.size())
-                result[i] = result[i] + coeffs[i];
-            if (i < other.coeffs.size())
-                result[i] = result[i] + other.coeffs[i];
-        }
-        return Polynomial(result);
+    // Addition. The longer operand is copied once and the shorter one added to it; an
+    // rvalue left operand is updated in place and its buffer reused.
+    Polynomial operator+(const Polynomial& other) const& {
+        const Polynomial& longer = coeffs.size() >= other.coeffs.size() ? *this : other;
+        const Polynomial& shorter = &longer == this ? other : *this;
+        vector<T> result = longer.coeffs;
+        for (size_t i = 0; i < shorter.coeffs.size(); i++)
+            result[i] = result[i] + shorter.coeffs[i];
+        return Polynomial(move(result));
+    }
+    Polynomial operator+(const Polynomial& other) && {
+        *this += other;
+        return move(*this);
     }
     Polynomial& operator+=(const Polynomial& other) {
-        *this = *this + other;
+        if(coeffs.size() < other.coeffs.size())
+            coeffs.resize(other.coeffs.size(), T(0));
+        for (size_t i = 0; i < other.coeffs.size(); i++)
+            coeffs[i] = coeffs[i] + other.coeffs[i];
+        normalize();
         return *this;
     }
     
     // Subtraction.
-    Polynomial operator-(const Polynomial& other) const {
-        vector<T> result(max(coeffs.size(), other.coeffs.size()), T(0));
-        for (size_t i = 0; i < result.size(); i++) {
-            if (i < coeffs.size())
-                result[i] = result[i] + coeffs[i];
-            if (i < other.coeffs.size())
-                result[i] = result[i] - other.coeffs[i];
-        }
-        return Polynomial(result);
+    Polynomial operator-(const Polynomial& other) const& {
+        vector<T> result = coeffs;
+        if(result.size() < other.coeffs.size())
+            result.resize(other.coeffs.size(), T(0));
+        for (size_t i = 0; i < other.coeffs.size(); i++)
+            result[i] = result[i] - other.coeffs[i];
+        return Polynomial(move(result));
+    }
+    Polynomial operator-(const Polynomial& other) && {
+        *this -= other;
+        return move(*this);
     }
     Polynomial& operator-=(const Polynomial& other) {
-        *this = *this - other;
+        if(coeffs.size() < other.coeffs.size())
+            coeffs.resize(other.coeffs.size(), T(0));
+        for (size_t i = 0; i < other.coeffs.size(); i++)
+            coeffs[i] = coeffs[i] - other.coeffs[i];
+        normalize();
         return *this;
     }
     
-    // Multiplication.
+    // Multiplication. convolve() picks schoolbook, Karatsuba, NTT or FFT from the operand sizes.
     Polynomial operator*(const Polynomial& other) const {
+        PROFILE_SCOPE(PolyMul);
         if(coeffs.empty() || other.coeffs.empty())
             return Polynomial();
-        vector<T> result(coeffs.size() + other.coeffs.size() - 1, T(0));
-        for (size_t i = 0; i < coeffs.size(); i++) {
-            for (size_t j = 0; j < other.coeffs.size(); j++) {
-                result[i+j] = result[i+j] + coeffs[i] * other.coeffs[j];
-            }
-        }
-        return Polynomial(result);
+        return Polynomial(convolve(coeffs, other.coeffs));
     }
     Polynomial& operator*=(const Polynomial& other) {
-        *this = *this * other;
+        PROFILE_SCOPE(PolyMul);
+        if(coeffs.empty() || other.coeffs.empty())
+            coeffs.clear();
+        else
+            coeffs = convolve(coeffs, other.coeffs);
+        normalize();
         return *this;
     }
     
+    // Lazy expressions (see poly_expr.h): p = lazy(a) * b + lazy(c) * d - e evaluates in
+    // one pass into p's existing buffer; p += lazy(a) * b accumulates into it.
+    template<typename E>
+    Polynomial(const PolyExpr<E>& expr) {
+        assign(expr);
+    }
+    template<typename E>
+    Polynomial& operator=(const PolyExpr<E>& expr) {
+        return assign(expr);
+    }
+    template<typename E>
+    Polynomial& assign(const PolyExpr<E>& expr);
+    template<typename E>
+    Polynomial& operator+=(const PolyExpr<E>& expr);
+    template<typename E>
+    Polynomial& operator-=(const PolyExpr<E>& expr);
+    
+    // First n coefficients of the polynomial (the remainder modulo x^n).
+    Polynomial truncated(int n) const {
+        if(n >= (int)coeffs.size())
+            return *this;
+        return Polynomial(vector<T>(coeffs.begin(), coeffs.begin() + max(0, n)));
+    }
+    
+    // Coefficients reversed within a window of n terms: x^(n-1) * P(1/x).
+    Polynomial reversed(int n) const {
+        vector<T> result(max(0, n), T(0));
+        for (int i = 0; i < n; i++)
+            result[i] = (*this)[n - 1 - i];
+        return Polynomial(move(result));
+    }
+    
+    // First n coefficients of the power series 1 / P(x), by Newton iteration
+    // g <- g * (2 - P * g), doubling the number of correct terms each step.
+    Polynomial inverse_series(int n) const {
+        if(coeffs.empty() || coeffs[0] == T(0))
+            throw runtime_error("Power series inverse requires a nonzero constant term");
+        Polynomial g(T(1) / coeffs[0]);
+        for (int k = 1; k < n; k *= 2) {
+            int len = min(2 * k, n);
+            Polynomial e = (truncated(len) * g).truncated(len);
+            g = (g * (Polynomial(T(2)) - e)).truncated(len);
+        }
+        return g.truncated(n);
+    }
+    
     // Division: returns a pair (quotient, remainder) such that A = divisor * quotient + remainder.
+    // Small cases run the in-place schoolbook loop; large ones use the Newton reciprocal of the
+    // reversed divisor, so the cost is a few multiplications.
     pair<Polynomial, Polynomial> divmod(const Polynomial& divisor) const {
-        if(divisor.coeffs.empty())
-            throw runtime_error("Division by zero polynomial");
-        Polynomial dividend = *this;
-        Polynomial quotient;
-        quotient.coeffs.resize(max(0, dividend.degree() - divisor.degree() + 1), T(0));
-        while(dividend.degree() >= divisor.degree() && dividend.degree() >= 0) {
-            int diff = dividend.degree() - divisor.degree();
-            T factor = dividend.coeffs.back() / divisor.coeffs.back();
-            vector<T> term(diff+1, T(0));
-            term[diff] = factor;
-            Polynomial<T> monomial(term);
-            quotient.coeffs[diff] = factor;
-            dividend = dividend - (divisor * monomial);
-            dividend.normalize();
-        }
-        quotient.normalize();
-        dividend.normalize();
-        return {quotient, dividend};
+        PROFILE_SCOPE(PolyDivmod);
+        return divide(divisor, true);
     }
     
     // Returns the quotient of the division.
     Polynomial operator/(const Polynomial& divisor) const {
-        return divmod(divisor).first;
+        return divide(divisor, false).first;
     }
     
     // Returns the remainder after division.
@@ -126,14 +191,16 @@ public:
         return divmod(divisor).second;
     }
     
-    // Exponentiation to a nonnegative integer power.
+    // Exponentiation to a nonnegative integer power. The full product is built; when only
+    // the first n coefficients are needed, series_pow (power_series.h) is much cheaper.
     Polynomial pow(unsigned int exponent) const {
         Polynomial result(T(1)); // The unit (constant) polynomial.
         Polynomial base = *this;
         while(exponent) {
             if(exponent & 1)
-                result = result * base;
-            base = base * base;
+                result *= base;
+            if(exponent > 1)
+                base *= base;
             exponent >>= 1;
         }
         return result;
@@ -148,6 +215,9 @@ public:
         return result;
     }
     
+    // Evaluate the polynomial at many points at once (subproduct tree, see multipoint.h).
+    vector<T> evaluate(span<const T> points) const;
+    
     // Overload the output operator for pretty printing.
     friend ostream& operator<<(ostream &os, const Polynomial& poly) {
         if(poly.coeffs.empty()){
@@ -175,4 +245,73 @@ public:
             os << "0";
         return os;
     }
-};
\ No newline at end of file
+
+private:
+    pair<Polynomial, Polynomial> divide(const Polynomial& divisor, bool with_remainder) const {
+        if(divisor.coeffs.empty())
+            throw runtime_error("Division by zero polynomial");
+        int n = degree(), m = divisor.degree();
+        if(n < m)
+            return {Polynomial(), *this};
+        if(min(m, n - m) <= DIVISION_NEWTON_THRESHOLD)
+            return divide_schoolbook(divisor);
+        // rev(A) = rev(B) * rev(Q) mod x^(n-m+1), where rev reverses the coefficient order.
+        int qlen = n - m + 1;
+        Polynomial rev_q = (reversed(n + 1).truncated(qlen) *
+                            divisor.reversed(m + 1).inverse_series(qlen)).truncated(qlen);
+        Polynomial quotient = rev_q.reversed(qlen);
+        if(!with_remainder)
+            return {quotient, Polynomial()};
+        // The remainder has degree < m, so only the low m terms of A - B * Q are needed.
+        Polynomial remainder = truncated(m) - (divisor * quotient).truncated(m);
+        return {quotient, remainder};
+    }
+    
+    // Long division on a single working copy of the dividend; no allocation per step.
+    pair<Polynomial, Polynomial> divide_schoolbook(const Polynomial& divisor) const {
+        int n = degree(), m = divisor.degree();
+        vector<T> rem = coeffs;
+        vector<T> quot(n - m + 1, T(0));
+        T lead_inv = T(1) / divisor.coeffs.back();
+        for (int i = n - m; i >= 0; i--) {
+            T factor = rem[i+m] * lead_inv;
+            quot[i] = factor;
+            if(factor == T(0))
+                continue;
+            for (int j = 0; j <= m; j++)
+                rem[i+j] = rem[i+j] - factor * divisor.coeffs[j];
+        }
+        rem.resize(m);
+        return {Polynomial(move(quot)), Polynomial(move(rem))};
+    }
+};
+
+//////////////////////////////
+// Polynomial helpers
+//////////////////////////////
+
+// The polynomial scaled so that its leading coefficient is 1 (zero stays zero).
+// Requires T to be a field.
+template<typename T>
+Polynomial<T> make_monic(const Polynomial<T>& poly) {
+    if(poly.degree() < 0 || poly.coeffs.back() == T(1))
+        return poly;
+    T lead_inv = T(1) / poly.coeffs.back();
+    vector<T> c = poly.coeffs;
+    for (auto &x : c)
+        x = x * lead_inv;
+    return Polynomial<T>(c);
+}
+
+// Formal derivative.
+template<typename T>
+Polynomial<T> derivative(const Polynomial<T>& f) {
+    vector<T> c(max(0, f.degree()), T(0));
+    for (int i = 1; i <= f.degree(); i++)
+        c[i-1] = f.coeffs[i] * T(i);
+    return Polynomial<T>(c);
+}
+
+// Batch evaluation and interpolation, and the lazy expressions, which complete the class above.
+#include "multipoint.h"
+#include "poly_expr.h"
\ No newline at end of file
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include "polynomial.h"
+
+using namespace std;
+
+//////////////////////////////
+// power_series.h
+//////////////////////////////
+
+// Truncated formal power series: every function returns the first n coefficients of its
+// result (the result modulo x^n). Inverse, log, exp and sqrt use Newton iteration, which
+// doubles the number of correct terms per step, so each costs a few multiplications of
+// length n, i.e. O(n log n) with the NTT. series_pow computes f^k as exp(k log f) and does
+// not depend on the size of k, unlike Polynomial::pow, which builds the full product.
+//
+// Coefficients are a field T (ModInt, DynModInt or double). log and exp divide by
+// 1 .. n-1, so over Z_p they need n <= p.
+
+// f' truncated to n terms.
+template<typename T>
+Polynomial<T> series_derivative(const Polynomial<T>& f, int n) {
+    vector<T> c(max(0, min(n, f.degree())));
+    for (size_t i = 0; i < c.size(); i++)
+        c[i] = f.coeffs[i+1] * T((long long)(i + 1));
+    return Polynomial<T>(move(c));
+}
+
+// 1/1, 1/2, ..., 1/(n-1) (entry 0 unused) with a single inversion, by prefix products.
+template<typename T>
+vector<T> series_reciprocals(int n) {
+    vector<T> inv(max(n, 1), T(1));
+    if(n <= 2)
+        return inv;
+    vector<T> prefix(n, T(1));
+    for (int i = 2; i < n; i++) {
+        prefix[i] = prefix[i-1] * T((long long)i);
+        if(prefix[i] == T(0))
+            throw runtime_error("Power series length exceeds the characteristic");
+    }
+    T running = T(1) / prefix[n-1];
+    for (int i = n - 1; i >= 1; i--) {
+        inv[i] = running * prefix[i-1];
+        running = running * T((long long)i);
+    }
+    return inv;
+}
+
+// The antiderivative with constant term 0, truncated to n terms.
+template<typename T>
+Polynomial<T> series_integral(const Polynomial<T>& f, int n) {
+    int len = min(n, f.degree() + 2);
+    if(len <= 1)
+        return Polynomial<T>();
+    vector<T> inv = series_reciprocals<T>(len);
+    vector<T> c(len, T(0));
+    for (int i = 1; i < len; i++)
+        c[i] = f.coeffs[i-1] * inv[i];
+    return Polynomial<T>(move(c));
+}
+
+template<typename T>
+Polynomial<T> series_inv(const Polynomial<T>& f, int n) {
+    return f.inverse_series(n);
+}
+
+// log f = integral(f' / f). Requires f(0) = 1.
+template<typename T>
+Polynomial<T> series_log(const Polynomial<T>& f, int n) {
+    if(f[0] != T(1))
+        throw runtime_error("Power series log requires constant term 1");
+    if(n <= 1)
+        return Polynomial<T>();
+    Polynomial<T> q = (series_derivative(f, n - 1) * f.inverse_series(n - 1)).truncated(n - 1);
+    return series_integral(q, n);
+}
+
+// exp f by Newton iteration g <- g * (1 - log g + f). Requires f(0) = 0.
+template<typename T>
+Polynomial<T> series_exp(const Polynomial<T>& f, int n) {
+    if(f[0] != T(0))
+        throw runtime_error("Power series exp requires constant term 0");
+    if(n <= 0)
+        return Polynomial<T>();
+    Polynomial<T> g(T(1));
+    for (int k = 1; k < n; k *= 2) {
+        int len = min(2 * k, n);
+        Polynomial<T> h = f.truncated(len) - series_log(g, len);
+        h += Polynomial<T>(T(1));
+        g = (g * h).truncated(len);
+    }
+    return g.truncated(n);
+}
+
+// Square roots of scalars: Tonelli-Shanks for prime fields (types with a static mod()),
+// std::sqrt for reals. Throw if there is none.
+template<typename T>
+T field_sqrt(const T& a) {
+    if(a == T(0))
+        return a;
+    unsigned long long p = (unsigned long long)T::mod();
+    if(p == 2)
+        return a;
+    if(a.pow((p - 1) / 2) != T(1))
+        throw runtime_error("Constant term is not a square modulo p");
+    // p - 1 = q * 2^s with q odd; z is any non-residue.
+    unsigned long long q = p - 1;
+    int s = 0;
+    while(q % 2 == 0) {
+        q /= 2;
+        s++;
+    }
+    T z(2);
+    while(z.pow((p - 1) / 2) == T(1))
+        z += T(1);
+    T c = z.pow(q), x = a.pow((q + 1) / 2), t = a.pow(q);
+    int m = s;
+    while(t != T(1)) {
+        int i = 0;
+        for (T u = t; u != T(1); u *= u)
+            i++;
+        T b = c;
+        for (int j = 0; j < m - i - 1; j++)
+            b *= b;
+        x *= b;
+        c = b * b;
+        t *= c;
+        m = i;
+    }
+    return x;
+}
+inline double field_sqrt(const double& a) {
+    if(a < 0)
+        throw runtime_error("Constant term is negative");
+    return sqrt(a);
+}
+
+// The integer k as a field element (k mod p over Z_p), and c^k for any 64-bit k; over
+// Z_p exponents are reduced modulo p - 1 (Fermat), which is exact for c != 0.
+template<typename T>
+T field_integer(unsigned long long k) {
+    if constexpr(is_floating_point_v<T>)
+        return T(k);
+    else
+        return T((long long)(k % (unsigned long long)T::mod()));
+}
+template<typename T>
+T field_pow(const T& c, unsigned long long k) {
+    if constexpr(is_floating_point_v<T>)
+        return std::pow(c, (T)k);
+    else
+        return c.pow((long long)(k % ((unsigned long long)T::mod() - 1)));
+}
+
+// sqrt f by Newton iteration g <- (g + f / g) / 2. A leading x^(2k) becomes x^k; the
+// lowest nonzero coefficient must be a square (its root is chosen by field_sqrt).
+template<typename T>
+Polynomial<T> series_sqrt(const Polynomial<T>& f, int n) {
+    if(n <= 0 || f.degree() < 0)
+        return Polynomial<T>();
+    int s = 0;
+    while(f.coeffs[s] == T(0))
+        s++;
+    if(s % 2)
+        throw runtime_error("Power series has no square root (odd lowest degree)");
+    int shift = s / 2;
+    if(shift >= n)
+        return Polynomial<T>();
+    int len = n - shift;
+    Polynomial<T> h(vector<T>(f.coeffs.begin() + s, f.coeffs.end()));
+    T half = T(1) / T(2);
+    Polynomial<T> g(field_sqrt(h.coeffs[0]));
+    for (int k = 1; k < len; k *= 2) {
+        int l = min(2 * k, len);
+        Polynomial<T> q = (h.truncated(l) * g.inverse_series(l)).truncated(l);
+        g = (g + q) * Polynomial<T>(half);
+    }
+    vector<T> c(shift, T(0));
+    c.insert(c.end(), g.coeffs.begin(), g.coeffs.begin() + min<size_t>(len, g.coeffs.size()));
+    return Polynomial<T>(move(c));
+}
+
+// f^k truncated to n terms. With f = c x^s h and h(0) = 1 this is
+// c^k x^(s k) exp(k log h), so the cost does not grow with k.
+template<typename T>
+Polynomial<T> series_pow(const Polynomial<T>& f, unsigned long long k, int n) {
+    if(n <= 0)
+        return Polynomial<T>();
+    if(k == 0)
+        return Polynomial<T>(T(1));
+    if(f.degree() < 0)
+        return Polynomial<T>();
+    unsigned long long s = 0;
+    while(f.coeffs[s] == T(0))
+        s++;
+    if(s > 0 && k >= ((unsigned long long)n + s - 1) / s)
+        return Polynomial<T>(); // x^(s k) is already beyond the truncation
+    int shift = (int)(s * k), len = n - shift;
+    T c = f.coeffs[s];
+    Polynomial<T> h(vector<T>(f.coeffs.begin() + s, f.coeffs.end()));
+    h = h * Polynomial<T>(T(1) / c);
+    // k enters the series only as a field element (k mod p over Z_p); c^k needs all of k.
+    Polynomial<T> e = series_exp(series_log(h, len) * Polynomial<T>(field_integer<T>(k)), len);
+    e = e * Polynomial<T>(field_pow(c, k));
+    vector<T> out(shift, T(0));
+    out.insert(out.end(), e.coeffs.begin(), e.coeffs.end());
+    return Polynomial<T>(move(out));
+}
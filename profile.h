@@ -0,0 +1,201 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#ifdef POLYCALC_PROFILE
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#endif
+
+using namespace std;
+
+//////////////////////////////
+// profile.h
+//////////////////////////////
+
+// Opt-in instrumentation of the hot paths. Build with -DPOLYCALC_PROFILE to enable it;
+// otherwise the PROFILE_* macros expand to nothing and this header adds no code.
+//
+// Each thread counts into its own block of counters (relaxed atomics with a single
+// writer, so no lock and no contention on the hot path). profile_snapshot() merges the
+// blocks of all live threads with the totals of threads that have exited.
+// Times are inclusive: a divmod that multiplies also shows up under poly_mul.
+//
+//   PROFILE_SCOPE(PolyMul);              // count and time the enclosing block
+//   PROFILE_ALLOC(n * sizeof(T));        // count one buffer allocation of n bytes
+//   PROFILE_REPORT_AT_EXIT();            // in main: print a summary when main returns
+
+enum class ProfileCounter {
+    PolyMul,
+    PolyDivmod,
+    PolyNormalize,
+    RingReduce,
+    RingExtendedGcd,
+    ModInverse,
+    CoeffAlloc,
+    Count
+};
+
+inline const char* profile_counter_name(ProfileCounter c) {
+    static const char* const names[] = {"poly_mul", "poly_divmod", "poly_normalize", "ring_reduce",
+                                        "ring_extended_gcd", "mod_inverse", "coeff_alloc"};
+    return names[(int)c];
+}
+
+#ifdef POLYCALC_PROFILE
+
+inline constexpr size_t PROFILE_COUNTERS = (size_t)ProfileCounter::Count;
+
+struct ProfileTotals {
+    uint64_t calls = 0, nanos = 0, bytes = 0;
+};
+
+struct ProfileSlot {
+    atomic<uint64_t> calls{0}, nanos{0}, bytes{0};
+
+    // Only the owning thread writes, so a load and a store replace the locked add.
+    static void bump(atomic<uint64_t>& v, uint64_t n) {
+        v.store(v.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+};
+
+struct ProfileThreadCounters;
+
+// All per-thread blocks, plus the totals of threads that have finished.
+struct ProfileRegistry {
+    mutex lock;
+    vector<ProfileThreadCounters*> live;
+    array<ProfileTotals, PROFILE_COUNTERS> retired{};
+
+    static ProfileRegistry& get() {
+        static ProfileRegistry registry;
+        return registry;
+    }
+};
+
+struct ProfileThreadCounters {
+    array<ProfileSlot, PROFILE_COUNTERS> slots;
+
+    ProfileThreadCounters() {
+        ProfileRegistry& r = ProfileRegistry::get();
+        lock_guard<mutex> guard(r.lock);
+        r.live.push_back(this);
+    }
+    ~ProfileThreadCounters() {
+        ProfileRegistry& r = ProfileRegistry::get();
+        lock_guard<mutex> guard(r.lock);
+        add_to(r.retired);
+        erase(r.live, this);
+    }
+
+    void add_to(array<ProfileTotals, PROFILE_COUNTERS>& totals) const {
+        for (size_t i = 0; i < PROFILE_COUNTERS; i++) {
+            totals[i].calls += slots[i].calls.load(memory_order_relaxed);
+            totals[i].nanos += slots[i].nanos.load(memory_order_relaxed);
+            totals[i].bytes += slots[i].bytes.load(memory_order_relaxed);
+        }
+    }
+};
+
+inline ProfileSlot& profile_slot(ProfileCounter c) {
+    thread_local ProfileThreadCounters counters;
+    return counters.slots[(size_t)c];
+}
+
+// Counts one call and its duration when the scope ends.
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileCounter c) : slot(profile_slot(c)), start(chrono::steady_clock::now()) {}
+    ~ProfileScope() {
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        ProfileSlot::bump(slot.calls, 1);
+        ProfileSlot::bump(slot.nanos, ns);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileSlot& slot;
+    chrono::steady_clock::time_point start;
+};
+
+inline void profile_alloc(uint64_t bytes) {
+    ProfileSlot& slot = profile_slot(ProfileCounter::CoeffAlloc);
+    ProfileSlot::bump(slot.calls, 1);
+    ProfileSlot::bump(slot.bytes, bytes);
+}
+
+// Current totals over all threads.
+inline array<ProfileTotals, PROFILE_COUNTERS> profile_snapshot() {
+    ProfileRegistry& r = ProfileRegistry::get();
+    lock_guard<mutex> guard(r.lock);
+    array<ProfileTotals, PROFILE_COUNTERS> totals = r.retired;
+    for (ProfileThreadCounters* t : r.live)
+        t->add_to(totals);
+    return totals;
+}
+
+inline void profile_report(ostream& os) {
+    auto totals = profile_snapshot();
+    os << "Profile summary:\n";
+    os << left << setw(20) << "counter" << right << setw(14) << "calls" << setw(14) << "total ms"
+       << setw(12) << "avg ns" << setw(16) << "bytes" << "\n";
+    for (size_t i = 0; i < PROFILE_COUNTERS; i++) {
+        const ProfileTotals& t = totals[i];
+        os << left << setw(20) << profile_counter_name((ProfileCounter)i) << right
+           << setw(14) << t.calls << fixed << setprecision(3) << setw(14) << t.nanos / 1e6
+           << setprecision(0) << setw(12) << (t.calls ? (double)t.nanos / t.calls : 0.0)
+           << setw(16) << t.bytes << "\n";
+    }
+}
+
+inline void profile_write_json(const string& path) {
+    auto totals = profile_snapshot();
+    ofstream os(path);
+    if(!os)
+        throw runtime_error("Cannot open " + path);
+    os << "{\n";
+    for (size_t i = 0; i < PROFILE_COUNTERS; i++) {
+        const ProfileTotals& t = totals[i];
+        os << "  \"" << profile_counter_name((ProfileCounter)i) << "\": {\"calls\": " << t.calls
+           << ", \"nanos\": " << t.nanos << ", \"bytes\": " << t.bytes << "}"
+           << (i + 1 < PROFILE_COUNTERS ? "," : "") << "\n";
+    }
+    os << "}\n";
+}
+
+// Prints the summary to stderr when destroyed, or writes JSON to the file named by the
+// POLYCALC_PROFILE_JSON environment variable if it is set.
+struct ProfileReporter {
+    ~ProfileReporter() {
+        try {
+            if(const char* path = getenv("POLYCALC_PROFILE_JSON"))
+                profile_write_json(path);
+            else
+                profile_report(cerr);
+        } catch (const exception &e) {
+            cerr << "Profile: " << e.what() << "\n";
+        }
+    }
+};
+
+#define PROFILE_SCOPE(counter) ProfileScope profile_scope_(ProfileCounter::counter)
+#define PROFILE_ALLOC(bytes) profile_alloc(bytes)
+#define PROFILE_REPORT_AT_EXIT() ProfileReporter profile_reporter_
+
+#else
+
+#define PROFILE_SCOPE(counter) ((void)0)
+#define PROFILE_ALLOC(bytes) ((void)0)
+#define PROFILE_REPORT_AT_EXIT() ((void)0)
+
+#endif
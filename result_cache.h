@@ -0,0 +1,261 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include "polynomial.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+//////////////////////////////
+// result_cache.h
+//////////////////////////////
+
+// Memoized results for programs that keep working with the same few moduli:
+// irreducibility verdicts, the per-modulus ModulusContext (reciprocal, Frobenius matrix,
+// packed copy) and recent inverses. RingCache<T>::shared() holds one cache per
+// coefficient type; every table is a bounded LRU guarded by a mutex, so it can be used
+// from any thread.
+//
+// Keys are the prime p and the coefficient values, with a 64-bit hash computed once per
+// key; a lookup compares the full key, so hash collisions never return a wrong result.
+// Results are computed outside the lock: two threads missing on the same key may both
+// compute it, and the later insertion wins.
+//
+//   RingCache<DynModInt<>>::shared().prewarm(moduli);   // at startup
+//   auto ring = RingCache<DynModInt<>>::shared().context(f);
+
+inline constexpr size_t RING_CACHE_MODULI = 256;    // verdicts and contexts
+inline constexpr size_t RING_CACHE_INVERSES = 4096;
+
+// Defined in factor_ring.h, which includes this file for run_factor_ring.
+template<typename T> class ModulusContext;
+template<typename T> class FactorRingElement;
+template<typename T> bool is_irreducible(const Polynomial<T>& poly);
+
+// A modulus (or a modulus and an element) in a prime field, as plain words.
+struct CacheKey {
+    vector<uint64_t> words;
+    uint64_t hash = 0;
+
+    friend bool operator==(const CacheKey& a, const CacheKey& b) {
+        return a.hash == b.hash && a.words == b.words;
+    }
+};
+
+struct CacheKeyHash {
+    size_t operator()(const CacheKey& k) const { return (size_t)k.hash; }
+};
+
+// Key words: p, then for each polynomial its length and its coefficient values.
+template<typename T>
+CacheKey make_cache_key(const Polynomial<T>& a, const Polynomial<T>* b = nullptr) {
+    CacheKey key;
+    key.words.reserve(2 + a.coeffs.size() + (b ? 1 + b->coeffs.size() : 0));
+    key.words.push_back((uint64_t)T::mod());
+    for (const Polynomial<T>* p : {&a, b}) {
+        if(!p)
+            continue;
+        key.words.push_back(p->coeffs.size());
+        for (const T& c : p->coeffs)
+            key.words.push_back((uint64_t)c.val());
+    }
+    // Multiply-xorshift mixing of every word, then a final avalanche (splitmix64).
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    for (uint64_t w : key.words) {
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    key.hash = h ^ (h >> 31);
+    return key;
+}
+
+struct CacheStats {
+    uint64_t hits = 0, misses = 0, evictions = 0;
+    size_t size = 0, capacity = 0;
+
+    double hit_rate() const {
+        return hits + misses ? (double)hits / (double)(hits + misses) : 0.0;
+    }
+};
+
+inline ostream& operator<<(ostream& os, const CacheStats& s) {
+    return os << s.hits << " hits, " << s.misses << " misses, " << s.evictions << " evictions, "
+              << s.size << "/" << s.capacity << " entries";
+}
+
+// Thread-safe least-recently-used map from CacheKey to V with at most `capacity` entries.
+template<typename V>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : cap(max<size_t>(1, capacity)) {}
+
+    // The cached value (now the most recently used), or nothing; counts a hit or a miss.
+    optional<V> get(const CacheKey& key) {
+        lock_guard<mutex> lock(m);
+        auto it = index.find(key);
+        if(it == index.end()) {
+            counters.misses++;
+            return nullopt;
+        }
+        counters.hits++;
+        order.splice(order.begin(), order, it->second);
+        return it->second->second;
+    }
+
+    // Inserts or replaces the value, evicting the least recently used entries if full.
+    void put(const CacheKey& key, V value) {
+        lock_guard<mutex> lock(m);
+        auto it = index.find(key);
+        if(it != index.end()) {
+            it->second->second = move(value);
+            order.splice(order.begin(), order, it->second);
+            return;
+        }
+        order.emplace_front(key, move(value));
+        index.emplace(key, order.begin());
+        evict();
+    }
+
+    // get, or compute(), store and return the value on a miss.
+    template<typename F>
+    V get_or_compute(const CacheKey& key, F compute) {
+        if(optional<V> v = get(key))
+            return *v;
+        V value = compute();
+        put(key, value);
+        return value;
+    }
+
+    CacheStats stats() const {
+        lock_guard<mutex> lock(m);
+        CacheStats s = counters;
+        s.size = order.size();
+        s.capacity = cap;
+        return s;
+    }
+
+    // Drops every entry; the statistics are kept.
+    void clear() {
+        lock_guard<mutex> lock(m);
+        index.clear();
+        order.clear();
+    }
+
+    void set_capacity(size_t capacity) {
+        lock_guard<mutex> lock(m);
+        cap = max<size_t>(1, capacity);
+        evict();
+    }
+
+private:
+    typedef list<pair<CacheKey, V>> Order;
+
+    void evict() {
+        while(order.size() > cap) {
+            index.erase(order.back().first);
+            order.pop_back();
+            counters.evictions++;
+        }
+    }
+
+    mutable mutex m;
+    size_t cap;
+    Order order; // most recently used first
+    unordered_map<CacheKey, typename Order::iterator, CacheKeyHash> index;
+    CacheStats counters;
+};
+
+// The cached results for factor rings over Z_p with coefficients of type T (a type with
+// a static mod(), as for is_irreducible).
+template<typename T>
+class RingCache {
+public:
+    typedef shared_ptr<const ModulusContext<T>> Context;
+
+    struct Stats {
+        CacheStats irreducible, contexts, inverses;
+    };
+
+    RingCache(size_t moduli = RING_CACHE_MODULI, size_t inverses = RING_CACHE_INVERSES)
+        : verdicts(moduli), contexts(moduli), inverse_table(inverses) {}
+
+    static RingCache& shared() {
+        static RingCache cache;
+        return cache;
+    }
+
+    bool is_irreducible(const Polynomial<T>& f) {
+        return verdicts.get_or_compute(make_cache_key(f), [&f] { return ::is_irreducible(f); });
+    }
+
+    // The shared context of the ring modulo f; elements built on it compare as the same
+    // ring by pointer.
+    Context context(const Polynomial<T>& f) {
+        return contexts.get_or_compute(make_cache_key(f), [&f] { return make_shared<const ModulusContext<T>>(f); });
+    }
+
+    FactorRingElement<T> element(const Polynomial<T>& a, const Polynomial<T>& f) {
+        return FactorRingElement<T>(a, context(f));
+    }
+
+    // a.inv(), remembered together with the elements that have no inverse (which throw
+    // the same error again).
+    FactorRingElement<T> inverse(const FactorRingElement<T>& a) {
+        CacheKey key = make_cache_key(a.modulus(), &a.poly);
+        optional<Polynomial<T>> result = inverse_table.get_or_compute(key, [&a]() -> optional<Polynomial<T>> {
+            try {
+                return a.inv().poly;
+            } catch(const runtime_error&) {
+                return nullopt;
+            }
+        });
+        if(!result)
+            throw runtime_error("Inverse does not exist in this factor ring");
+        return FactorRingElement<T>(*result, a.ctx);
+    }
+
+    // Computes the verdict and the context of every modulus ahead of use, in parallel.
+    // Moduli that are not irreducible are cached too (with their verdict).
+    void prewarm(const vector<Polynomial<T>>& moduli) {
+        parallel_for(0, moduli.size(), 1, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++) {
+                if(moduli[i].degree() < 0)
+                    continue;
+                is_irreducible(moduli[i]);
+                context(moduli[i]);
+            }
+        });
+    }
+
+    Stats stats() const {
+        return {verdicts.stats(), contexts.stats(), inverse_table.stats()};
+    }
+
+    void clear() {
+        verdicts.clear();
+        contexts.clear();
+        inverse_table.clear();
+    }
+
+    void set_capacity(size_t moduli, size_t inverses) {
+        verdicts.set_capacity(moduli);
+        contexts.set_capacity(moduli);
+        inverse_table.set_capacity(inverses);
+    }
+
+private:
+    LruCache<bool> verdicts;
+    LruCache<Context> contexts;
+    LruCache<optional<Polynomial<T>>> inverse_table;
+};
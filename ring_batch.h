@@ -0,0 +1,126 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <span>
+#include "factor_ring.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+//////////////////////////////
+// ring_batch.h
+//////////////////////////////
+
+// Element-wise operations on arrays of factor ring elements, spread over the shared
+// work-stealing pool (thread_pool.h). Each call splits its array into grains of
+// RING_BATCH_GRAIN elements; arrays of one grain run on the calling thread.
+//
+// batch_inv uses Montgomery's trick: with prefix products p_i = a_0 * ... * a_i, one
+// inversion of p_{n-1} gives every inverse by walking back, a_i^-1 = p_{i-1} * p_i^-1 and
+// p_{i-1}^-1 = a_i * p_i^-1. The prefix and backward passes run per grain in parallel and
+// the grain totals are chained on the calling thread, so n inverses cost a single inv()
+// and about 3n multiplications.
+
+inline constexpr size_t RING_BATCH_GRAIN = 256;
+
+// n zero elements of the ring of `like`, used as output slots. Unlike default-constructed
+// elements they share the existing context and allocate no coefficients.
+template<typename T>
+vector<FactorRingElement<T>> ring_slots(size_t n, const FactorRingElement<T>& like) {
+    return vector<FactorRingElement<T>>(n, FactorRingElement<T>(Polynomial<T>(), like.ctx));
+}
+
+// out[i] = a[i] * b[i].
+template<typename T>
+vector<FactorRingElement<T>> batch_mul(span<const FactorRingElement<T>> a, span<const FactorRingElement<T>> b,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    if(a.size() != b.size())
+        throw invalid_argument("batch_mul needs arrays of equal length");
+    if(a.empty())
+        return {};
+    vector<FactorRingElement<T>> out = ring_slots(a.size(), a[0]);
+    parallel_for(0, a.size(), RING_BATCH_GRAIN, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+            out[i] = a[i] * b[i];
+    }, pool);
+    return out;
+}
+
+// out[i] = a[i]^exponent.
+template<typename T>
+vector<FactorRingElement<T>> batch_pow(span<const FactorRingElement<T>> a, unsigned long long exponent,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    if(a.empty())
+        return {};
+    vector<FactorRingElement<T>> out = ring_slots(a.size(), a[0]);
+    // Powers are much more expensive than products, so smaller grains balance better.
+    parallel_for(0, a.size(), max<size_t>(1, RING_BATCH_GRAIN / 16), [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+            out[i] = a[i].pow(exponent);
+    }, pool);
+    return out;
+}
+
+// out[i] = a[i]^-1. Throws if some element is not invertible (then their product is not).
+template<typename T>
+vector<FactorRingElement<T>> batch_inv(span<const FactorRingElement<T>> a,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    size_t n = a.size();
+    if(n == 0)
+        return {};
+    vector<FactorRingElement<T>> out = ring_slots(n, a[0]);
+    size_t grains = (n + RING_BATCH_GRAIN - 1) / RING_BATCH_GRAIN;
+    // Prefix products within each grain, stored in out.
+    parallel_for(0, grains, 1, [&](size_t lo, size_t hi) {
+        for (size_t g = lo; g < hi; g++) {
+            size_t begin = g * RING_BATCH_GRAIN, end = min(n, begin + RING_BATCH_GRAIN);
+            out[begin] = a[begin];
+            for (size_t i = begin + 1; i < end; i++)
+                out[i] = out[i-1] * a[i];
+        }
+    }, pool);
+    // The same trick across the grain totals, with the only inversion.
+    vector<FactorRingElement<T>> chain = ring_slots(grains, a[0]), total_inv = ring_slots(grains, a[0]);
+    chain[0] = out[min(n, RING_BATCH_GRAIN) - 1];
+    for (size_t g = 1; g < grains; g++)
+        chain[g] = chain[g-1] * out[min(n, (g + 1) * RING_BATCH_GRAIN) - 1];
+    FactorRingElement<T> running = chain[grains - 1].inv();
+    for (size_t g = grains; g-- > 1;) {
+        total_inv[g] = running * chain[g-1];
+        running = running * out[min(n, (g + 1) * RING_BATCH_GRAIN) - 1];
+    }
+    total_inv[0] = running;
+    // Backward pass within each grain, starting from the inverse of its total.
+    parallel_for(0, grains, 1, [&](size_t lo, size_t hi) {
+        for (size_t g = lo; g < hi; g++) {
+            size_t begin = g * RING_BATCH_GRAIN, end = min(n, begin + RING_BATCH_GRAIN);
+            FactorRingElement<T> r = total_inv[g];
+            for (size_t i = end - 1; i > begin; i--) {
+                FactorRingElement<T> next = r * a[i];
+                out[i] = r * out[i-1];
+                r = move(next);
+            }
+            out[begin] = r;
+        }
+    }, pool);
+    return out;
+}
+
+template<typename T>
+vector<FactorRingElement<T>> batch_mul(const vector<FactorRingElement<T>>& a, const vector<FactorRingElement<T>>& b,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    return batch_mul(span<const FactorRingElement<T>>(a), span<const FactorRingElement<T>>(b), pool);
+}
+template<typename T>
+vector<FactorRingElement<T>> batch_pow(const vector<FactorRingElement<T>>& a, unsigned long long exponent,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    return batch_pow(span<const FactorRingElement<T>>(a), exponent, pool);
+}
+template<typename T>
+vector<FactorRingElement<T>> batch_inv(const vector<FactorRingElement<T>>& a,
+                                       ThreadPool& pool = ThreadPool::shared()) {
+    return batch_inv(span<const FactorRingElement<T>>(a), pool);
+}
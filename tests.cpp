@@ -0,0 +1,1177 @@
+#include "polynomial.h"
+#include "modint.h"
+#include "factor_ring.h"
+#include "dynmodint.h"
+#include "factorization.h"
+#include "poly_gcd.h"
+#include "multipoint.h"
+#include "simd_eval.h"
+#include "batch.h"
+#include "poly_io.h"
+#include "profile.h"
+#include "poly_expr.h"
+#include "thread_pool.h"
+#include "ring_batch.h"
+#include "galois_field.h"
+#include "gf2poly.h"
+#include "power_series.h"
+#include "bigint.h"
+#include "result_cache.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+
+
+
+//////////////////////////////
+// tests.cpp
+//////////////////////////////
+
+// Self-checks for the arithmetic kernels. Every fast path is compared against a schoolbook
+// or naive reference on random inputs, with sizes just below, at and just above the
+// threshold that selects it. There is one group per component; the program prints one
+// line per group and exits with status 1 if any check failed.
+//
+//   g++ -std=c++20 -O2 -pthread tests.cpp -o polytests
+//   polytests [--filter S]     # only the groups whose name contains S
+//
+// The shared thread pool gets at least four threads unless POLYCALC_THREADS sets the count.
+
+//////////////////////////////
+// Harness
+//////////////////////////////
+
+static size_t checks_run = 0, checks_failed = 0;
+
+// Records one comparison; the first few failures of a run are printed.
+void check(bool ok, const string& what) {
+    checks_run++;
+    if(ok)
+        return;
+    if(++checks_failed <= 20)
+        cout << "  FAIL " << what << endl;
+}
+
+// Sizes just below, at and just above each threshold.
+vector<size_t> around(initializer_list<size_t> thresholds) {
+    vector<size_t> sizes;
+    for (size_t t : thresholds)
+        for (size_t s : {t - 1, t, t + 1})
+            sizes.push_back(s);
+    return sizes;
+}
+
+template<typename T>
+vector<T> random_coeffs(size_t n, mt19937_64& rng) {
+    vector<T> c(n);
+    for (auto &x : c) {
+        if constexpr (is_same_v<T, double>)
+            x = (double)(long long)(rng() % 2001) - 1000;
+        else
+            x = T((long long)(rng() >> 2));
+    }
+    return c;
+}
+
+// Random polynomial of exactly the given degree.
+template<typename T>
+Polynomial<T> random_poly(int degree, mt19937_64& rng) {
+    vector<T> c = random_coeffs<T>(degree + 1, rng);
+    if(c.back() == T(0))
+        c.back() = T(1);
+    return Polynomial<T>(c);
+}
+
+template<typename T>
+vector<T> naive_mul(const vector<T>& a, const vector<T>& b) {
+    if(a.empty() || b.empty())
+        return {};
+    vector<T> res(a.size() + b.size() - 1, T(0));
+    for (size_t i = 0; i < a.size(); i++)
+        for (size_t j = 0; j < b.size(); j++)
+            res[i+j] = res[i+j] + a[i] * b[j];
+    return res;
+}
+
+string sizes(size_t n, size_t m) {
+    return "n=" + to_string(n) + " m=" + to_string(m);
+}
+
+//////////////////////////////
+// Groups
+//////////////////////////////
+
+// Schoolbook, Karatsuba, NTT and multi-prime CRT products (convolution.h, ntt.h).
+template<typename T>
+void check_products(const string& name, initializer_list<size_t> thresholds, mt19937_64& rng) {
+    for (size_t n : around(thresholds)) {
+        for (size_t m : {n, 3 * n + 5}) {
+            vector<T> a = random_coeffs<T>(n, rng), b = random_coeffs<T>(m, rng);
+            check(convolve(a, b) == naive_mul(a, b), name + " product " + sizes(n, m));
+        }
+        vector<T> a = random_coeffs<T>(n, rng);
+        check(convolve(a, a) == naive_mul(a, a), name + " square n=" + to_string(n));
+    }
+}
+
+void test_convolution() {
+    mt19937_64 rng(1);
+    check_products<ModInt<998244353>>("ModInt<998244353>", {KARATSUBA_THRESHOLD, NTT_THRESHOLD, NTT_CRT_THRESHOLD}, rng);
+    check_products<ModInt<1000000007>>("ModInt<1000000007>", {KARATSUBA_THRESHOLD, NTT_CRT_THRESHOLD}, rng);
+}
+
+// Long division over a field.
+template<typename T>
+pair<Polynomial<T>, Polynomial<T>> naive_divmod(const Polynomial<T>& a, const Polynomial<T>& b) {
+    vector<T> r = a.coeffs;
+    int m = b.degree();
+    vector<T> q(max(0, a.degree() - m + 1), T(0));
+    T lead_inv = T(1) / b.coeffs.back();
+    for (int k = (int)r.size() - 1; k >= m; k--) {
+        T c = r[k] * lead_inv;
+        q[k-m] = c;
+        for (int j = 0; j <= m; j++)
+            r[k-m+j] = r[k-m+j] - c * b.coeffs[j];
+    }
+    r.resize(max(0, m));
+    return {Polynomial<T>(q), Polynomial<T>(r)};
+}
+
+// Newton reciprocal division against long division (polynomial.h).
+template<typename T>
+void check_division(const string& name, mt19937_64& rng) {
+    int t = DIVISION_NEWTON_THRESHOLD;
+    for (int m : {1, t - 1, t, t + 1, 3 * t}) {
+        for (int q : {0, t - 1, t, t + 1, 3 * t}) {
+            Polynomial<T> b = random_poly<T>(m, rng), a = random_poly<T>(m + q, rng);
+            auto [quot, rem] = a.divmod(b);
+            auto [want_q, want_r] = naive_divmod(a, b);
+            check(quot.coeffs == want_q.coeffs && rem.coeffs == want_r.coeffs,
+                  name + " divmod deg " + to_string(m + q) + " / " + to_string(m));
+            check((a / b).coeffs == want_q.coeffs, name + " quotient deg " + to_string(m + q) + " / " + to_string(m));
+        }
+    }
+}
+
+void test_division() {
+    mt19937_64 rng(2);
+    check_division<ModInt<998244353>>("ModInt<998244353>", rng);
+    check_division<ModInt<1000000007>>("ModInt<1000000007>", rng);
+}
+
+// Reduction through the precomputed reciprocal of a shared ModulusContext (factor_ring.h).
+void test_modulus_context() {
+    mt19937_64 rng(13);
+    typedef ModInt<998244353> M;
+    int t = DIVISION_NEWTON_THRESHOLD;
+    for (int n : {1, 5, t - 1, t + 1, 3 * t}) {
+        Polynomial<M> f = random_poly<M>(n, rng);
+        auto ctx = make_shared<const ModulusContext<M>>(f);
+        Polynomial<M> a = random_poly<M>(n - 1, rng), b = random_poly<M>(n - 1, rng);
+        string what = " n=" + to_string(n);
+        check(ctx->reduce(a * b).coeffs == naive_divmod(a * b, f).second.coeffs, "ring reduction" + what);
+        FactorRingElement<M> x(a, ctx), y(b, ctx);
+        check((x * y).poly.coeffs == naive_divmod(a * b, f).second.coeffs, "ring product" + what);
+        check((x * y).ctx == x.ctx, "product shares the context" + what);
+    }
+}
+
+// Montgomery DynModInt: products (multi-prime CRT path) and division, up to 61-bit primes.
+void test_dynmodint() {
+    mt19937_64 rng(14);
+    typedef DynModInt<> D;
+    for (uint64_t p : {3ULL, 1000000007ULL, (1ULL << 61) - 1}) {
+        D::set_mod(p);
+        string name = "DynModInt<" + to_string(p) + ">";
+        bool field = true;
+        for (int i = 0; i < 1000; i++) {
+            D x((long long)(rng() >> 2)), y((long long)(rng() >> 2));
+            if(x.val() != 0)
+                field = field && x * x.inv() == D(1);
+            unsigned __int128 want = (unsigned __int128)x.val() * y.val() % p;
+            field = field && (x * y).val() == (uint64_t)want;
+        }
+        check(field, name + " products and inverses");
+        if(p > 3)
+            check_products<D>(name, {KARATSUBA_THRESHOLD, NTT_THRESHOLD, NTT_CRT_THRESHOLD}, rng);
+    }
+    D::set_mod(1000000007);
+    check_division<D>("DynModInt<1000000007>", rng);
+}
+
+// Number of monic irreducible polynomials of degree n over F_p (Gauss's formula).
+long long irreducible_count(long long p, int n) {
+    auto mobius = [](int d) {
+        int mu = 1;
+        for (int q = 2; q * q <= d; q++) {
+            if(d % q)
+                continue;
+            d /= q;
+            if(d % q == 0)
+                return 0;
+            mu = -mu;
+        }
+        return d > 1 ? -mu : mu;
+    };
+    long long sum = 0;
+    for (int d = 1; d <= n; d++) {
+        if(n % d)
+            continue;
+        long long pw = 1;
+        for (int i = 0; i < n / d; i++)
+            pw *= p;
+        sum += mobius(d) * pw;
+    }
+    return sum / n;
+}
+
+// Counts the monic irreducibles of degree n over F_p by testing every candidate.
+template<typename T>
+long long count_irreducible(long long p, int n) {
+    long long total = 1, count = 0;
+    for (int i = 0; i < n; i++)
+        total *= p;
+    vector<T> c(n + 1, T(0));
+    c[n] = T(1);
+    for (long long idx = 0; idx < total; idx++) {
+        long long v = idx;
+        for (int i = 0; i < n; i++, v /= p)
+            c[i] = T(v % p);
+        count += is_irreducible(Polynomial<T>(c));
+    }
+    return count;
+}
+
+// Ben-Or irreducibility test (factor_ring.h).
+void test_irreducibility() {
+    for (int n = 1; n <= 10; n++)
+        check(count_irreducible<ModInt<2>>(2, n) == irreducible_count(2, n), "Z_2 irreducible count, degree " + to_string(n));
+    typedef DynModInt<> D;
+    for (auto [p, max_deg] : {pair<long long, int>{3, 6}, {5, 4}, {257, 2}}) {
+        D::set_mod(p);
+        for (int n = 1; n <= max_deg; n++)
+            check(count_irreducible<D>(p, n) == irreducible_count(p, n),
+                  "Z_" + to_string(p) + " irreducible count, degree " + to_string(n));
+    }
+    // Large p (Frobenius matrix path): products are reducible.
+    mt19937_64 rng(4);
+    D::set_mod(1000000007);
+    for (int n : {2, 5, 17, 40}) {
+        Polynomial<D> f = make_monic(random_poly<D>(n, rng)) * make_monic(random_poly<D>(3, rng));
+        check(!is_irreducible(f), "product of degree " + to_string(n) + " and 3 is reducible");
+    }
+}
+
+// Distinct-degree, Cantor-Zassenhaus and Berlekamp factorization (factorization.h).
+template<typename T>
+void check_factorization(const string& name, bool berlekamp, mt19937_64& rng) {
+    for (int total : {10, FACTOR_PARALLEL_MIN_DEGREE - 1, FACTOR_PARALLEL_MIN_DEGREE + 1, 70}) {
+        // Random monic factors, one of them repeated.
+        Polynomial<T> f(T(0) - T(1)); // a non-monic unit
+        int deg = 0;
+        while(deg < total) {
+            int d = min<int>(total - deg, 1 + rng() % 6);
+            Polynomial<T> g = make_monic(random_poly<T>(d, rng));
+            f = f * g;
+            deg += d;
+            if(deg == d && deg < total - d) {
+                f = f * g;
+                deg += d;
+            }
+        }
+        string what = name + " degree " + to_string(f.degree());
+        vector<FactorMethod> methods = {FactorMethod::CantorZassenhaus};
+        if(berlekamp)
+            methods.push_back(FactorMethod::Berlekamp);
+        vector<vector<pair<Polynomial<T>, int>>> results;
+        for (FactorMethod method : methods) {
+            Factorization<T> r = factor(f, method);
+            Polynomial<T> prod(r.unit);
+            bool irreducible = true;
+            for (auto &[g, e] : r.factors) {
+                irreducible = irreducible && g.coeffs.back() == T(1) && is_irreducible(g);
+                for (int i = 0; i < e; i++)
+                    prod = prod * g;
+            }
+            check(prod.coeffs == f.coeffs, what + ": factors multiply back");
+            check(irreducible, what + ": factors are monic and irreducible");
+            results.push_back(r.factors);
+        }
+        if(results.size() == 2) {
+            bool same = results[0].size() == results[1].size();
+            for (size_t i = 0; same && i < results[0].size(); i++)
+                same = results[0][i].first.coeffs == results[1][i].first.coeffs && results[0][i].second == results[1][i].second;
+            check(same, what + ": Berlekamp agrees with Cantor-Zassenhaus");
+        }
+    }
+}
+
+void test_factorization() {
+    mt19937_64 rng(5);
+    check_factorization<ModInt<2>>("Z_2", true, rng);
+    for (uint64_t p : {3ULL, 13ULL, 1000000007ULL}) {
+        DynModInt<>::set_mod(p);
+        check_factorization<DynModInt<>>("Z_" + to_string(p), p <= BERLEKAMP_MAX_P, rng);
+    }
+    // The irreducibility verdict agrees with the factorization over a large prime.
+    typedef DynModInt<> D;
+    D::set_mod(1000000007);
+    for (int n : {2, 5, 17, 40}) {
+        Polynomial<D> g = make_monic(random_poly<D>(n, rng));
+        Factorization<D> fg = factor(g);
+        bool single = fg.factors.size() == 1 && fg.factors[0].second == 1;
+        check(is_irreducible(g) == single, "is_irreducible agrees with factor, degree " + to_string(n));
+    }
+}
+
+// Half-GCD extended gcd against the iterative Euclidean algorithm (poly_gcd.h).
+void test_gcd() {
+    mt19937_64 rng(3);
+    typedef DynModInt<> D;
+    D::set_mod(1000000007);
+    for (int n : {10, HGCD_THRESHOLD - 1, HGCD_THRESHOLD, HGCD_THRESHOLD + 1, 3 * HGCD_THRESHOLD}) {
+        // A common factor of degree 7 on top of two random cofactors.
+        Polynomial<D> g = random_poly<D>(7, rng);
+        Polynomial<D> a = g * random_poly<D>(n, rng), b = g * random_poly<D>(n - 3, rng);
+        auto [g1, x1, y1] = poly_extended_gcd(a, b);
+        auto [g2, x2, y2] = extended_gcd_iterative(a, b);
+        string what = " deg " + to_string(n + 7);
+        check(make_monic(g1).coeffs == make_monic(g2).coeffs, "half-GCD gcd matches Euclid" + what);
+        check((a * x1 + b * y1).coeffs == g1.coeffs, "half-GCD Bezout identity" + what);
+        check(make_monic(poly_gcd(a, b)).coeffs == make_monic(g2).coeffs, "poly_gcd" + what);
+        check((g2 % g).degree() < 0, "gcd contains the common factor" + what);
+    }
+    // Factor ring inverses go through the half-GCD above the threshold. Over Z_(10^9+7) a
+    // random element is coprime to a random modulus with overwhelming probability.
+    for (int n : {HGCD_THRESHOLD - 1, 2 * HGCD_THRESHOLD + 1}) {
+        auto ctx = make_shared<const ModulusContext<D>>(random_poly<D>(n, rng));
+        FactorRingElement<D> a(random_poly<D>(n - 1, rng), ctx);
+        check((a * a.inv()).poly.coeffs == vector<D>{D(1)}, "factor ring inverse n=" + to_string(n));
+    }
+}
+
+// Subproduct-tree multipoint evaluation and interpolation (multipoint.h).
+void test_multipoint() {
+    mt19937_64 rng(7);
+    typedef ModInt<998244353> M;
+    for (size_t n : {1, MULTIPOINT_LEAF - 1, MULTIPOINT_LEAF + 1, 5 * MULTIPOINT_LEAF, MULTIPOINT_PARALLEL_MIN + 100}) {
+        vector<M> pts = random_coeffs<M>(n, rng);
+        Polynomial<M> f = random_poly<M>(n + 10, rng);
+        SubproductTree<M> tree(pts);
+        vector<M> vals = tree.evaluate(f);
+        bool same = true;
+        for (size_t i = 0; same && i < n; i += 1 + n / 200)
+            same = vals[i] == f.evaluate(pts[i]);
+        check(same, "subproduct tree evaluation n=" + to_string(n));
+        if(n <= 1000) {
+            // Distinct points: 1, 2, ..., n.
+            vector<M> xs(n), ys = random_coeffs<M>(n, rng);
+            for (size_t i = 0; i < n; i++)
+                xs[i] = M((long long)i + 1);
+            Polynomial<M> g = SubproductTree<M>(xs).interpolate(ys);
+            bool fits = g.degree() < (int)n;
+            for (size_t i = 0; fits && i < n; i++)
+                fits = g.evaluate(xs[i]) == ys[i];
+            check(fits, "interpolation n=" + to_string(n));
+        }
+    }
+}
+
+// A scratch file name in the system temporary directory.
+string temp_path(const string& name) {
+    return (filesystem::temp_directory_path() / ("polytests-" + name)).string();
+}
+
+// SIMD batch evaluation (each available instruction set) and streaming evaluation (simd_eval.h).
+void test_simd_eval() {
+    mt19937_64 rng(12);
+    uniform_real_distribution<double> unit(-1.0, 1.0);
+    vector<SimdLevel> levels = {SimdLevel::Scalar};
+    if(simd_level() >= SimdLevel::AVX2)
+        levels.push_back(SimdLevel::AVX2);
+    if(simd_level() >= SimdLevel::AVX512)
+        levels.push_back(SimdLevel::AVX512);
+    for (int deg : {0, 5, ESTRIN_MIN_DEGREE - 1, ESTRIN_MIN_DEGREE, ESTRIN_MIN_DEGREE + ESTRIN_BLOCK + 3, 300}) {
+        vector<double> c(deg + 1), x(37), out(37);
+        for (auto &v : c)
+            v = unit(rng);
+        for (auto &v : x)
+            v = unit(rng);
+        Polynomial<double> p(c);
+        for (SimdLevel level : levels) {
+            evaluate_batch(c, x.data(), out.data(), x.size(), level);
+            bool close = true;
+            for (size_t i = 0; i < x.size(); i++)
+                close = close && fabs(out[i] - p.evaluate(x[i])) <= 1e-12 * (deg + 1);
+            check(close, "evaluate_batch degree " + to_string(deg) + " level " + to_string((int)level));
+        }
+    }
+    // Streaming evaluation over several chunks, and a file that ends in a partial double.
+    vector<double> c = {0.5, -2, 0, 1.25}, xs(1000);
+    for (auto &v : xs)
+        v = unit(rng);
+    string in_path = temp_path("points.bin"), out_path = temp_path("values.bin");
+    FILE* f = fopen(in_path.c_str(), "wb");
+    fwrite(xs.data(), sizeof(double), xs.size(), f);
+    fclose(f);
+    check(evaluate_stream(c, in_path, out_path, 64) == xs.size(), "evaluate_stream point count");
+    vector<double> ys(xs.size() + 1);
+    f = fopen(out_path.c_str(), "rb");
+    bool close = fread(ys.data(), sizeof(double), ys.size(), f) == xs.size();
+    fclose(f);
+    Polynomial<double> p(c);
+    for (size_t i = 0; close && i < xs.size(); i++)
+        close = fabs(ys[i] - p.evaluate(xs[i])) <= 1e-12;
+    check(close, "evaluate_stream values");
+    f = fopen(in_path.c_str(), "ab");
+    fputc(0, f);
+    fclose(f);
+    bool thrown = false;
+    try {
+        evaluate_stream(c, in_path, out_path, 64);
+    } catch(const runtime_error&) {
+        thrown = true;
+    }
+    check(thrown, "evaluate_stream rejects a trailing partial double");
+    remove(in_path.c_str());
+    remove(out_path.c_str());
+}
+
+// Karatsuba and FFT products of doubles, their error bound and the schoolbook fallback (fft.h).
+void test_fft() {
+    mt19937_64 rng(15);
+    // Integer inputs give exact products below 2^53, so rounding must recover them.
+    for (size_t n : around({KARATSUBA_THRESHOLD, FFT_THRESHOLD})) {
+        for (size_t m : {n, FFT_SPLIT_RATIO * n + 1}) {
+            vector<double> a = random_coeffs<double>(n, rng), b = random_coeffs<double>(m, rng);
+            vector<double> got = convolve(a, b), want = naive_mul(a, b);
+            bool same = got.size() == want.size();
+            for (size_t i = 0; same && i < got.size(); i++)
+                same = llround(got[i]) == llround(want[i]);
+            check(same, "double product " + sizes(n, m));
+        }
+    }
+    // Real inputs: the reported bound covers the actual error.
+    uniform_real_distribution<double> unit(-1.0, 1.0);
+    for (size_t n : {(size_t)KARATSUBA_THRESHOLD / 2, (size_t)KARATSUBA_THRESHOLD + 5, 2 * FFT_THRESHOLD + 3}) {
+        vector<double> a(n), b(n + 7);
+        for (auto &x : a)
+            x = unit(rng);
+        for (auto &x : b)
+            x = unit(rng);
+        double bound = -1;
+        vector<double> got = convolve(a, b, &bound), want = naive_mul(a, b);
+        double error = 0;
+        for (size_t i = 0; i < got.size(); i++)
+            error = max(error, fabs(got[i] - want[i]));
+        string what = " n=" + to_string(n);
+        check(n <= KARATSUBA_THRESHOLD ? bound == 0 : bound > 0, "error bound reported" + what);
+        check(error <= max(bound, 1e-12), "error within the bound" + what);
+    }
+    // A tiny coefficient next to large ones must survive (schoolbook fallback).
+    vector<double> a = random_coeffs<double>(2 * FFT_THRESHOLD, rng), b = random_coeffs<double>(2 * FFT_THRESHOLD, rng);
+    a[0] = b[0] = 1e-9;
+    double bound = -1;
+    vector<double> c = convolve(a, b, &bound);
+    check(fabs(c[0] - 1e-18) <= 1e-22, "double product keeps a 1e-18 term");
+    check(bound == 0, "schoolbook fallback reports no transform error");
+    // Too large for the fallback: the transform result comes with a bound that shows the
+    // tiny term is lost.
+    size_t big = (size_t)sqrt(FFT_FALLBACK_MAX_WORK) + 100;
+    a.assign(big, 1.0);
+    a[0] = 1e-18;
+    c = convolve(a, a, &bound);
+    check(bound > FFT_RELATIVE_TOLERANCE * 1e-36, "unreliable large product reports its bound");
+}
+
+// Runs a batch script from memory; returns the output and the number of failed records.
+pair<string, size_t> run_batch_script(const string& script) {
+    FILE* in = fmemopen((void*)script.data(), script.size(), "r");
+    char* buf = nullptr;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    size_t failures = run_batch(in, out);
+    fclose(in);
+    fclose(out);
+    string result(buf, len);
+    free(buf);
+    return {result, failures};
+}
+
+// Non-interactive batch mode: results, error lines and the exit status (batch.h).
+void test_batch() {
+    auto [out, failures] = run_batch_script(
+        "mul 2 1 1 2 -1 1   # (1 + x)(-1 + x)\n"
+        "div 3 -1 0 1 2 1 1\n"
+        "pow 2 1 1 3\n"
+        "mod 7\n"
+        "factor 3 6 0 1\n"
+        "inv 2 1 1 3 1 0 1\n");
+    check(out == "3 -1 0 1\n2 -1 1 0\n4 1 3 3 1\n1 2 1 2 1 1 1 2 6 1\n2 4 3\n", "mul, div, pow, factor and inv results");
+    check(failures == 0, "no failed records");
+    // A failed record writes one error line and the next line is processed.
+    tie(out, failures) = run_batch_script("div 2 1 1 0\nadd 1 1 1 2\n");
+    check(out == "error Division by zero polynomial\n1 3\n", "division by zero, then the next record");
+    check(failures == 1, "division by zero counts as a failure");
+    tie(out, failures) = run_batch_script("mul 2 1 x 1 1\neval 2 1 1 0.5e\nmul -1\nsub 1 1 1 1\n");
+    check(out == "error Bad number 'x'\nerror Bad number '0.5e'\nerror Negative coefficient count\n0\n",
+          "malformed numbers");
+    check(failures == 3, "malformed numbers count as failures");
+    tie(out, failures) = run_batch_script("mod 4\nmod 5\nmul 2 1 1 2 1");
+    check(out == "error 4 is not a prime number\nerror Unexpected end of input\n", "bad prime and truncated input");
+    // Exit status of polycalc --batch.
+    string path = temp_path("batch.txt");
+    FILE* null_out = fopen("/dev/null", "w");
+    for (auto [script, status] : {pair<string, int>{"add 1 1 1 2\n", 0}, {"add 1 1 1 2\nfactor 1 1\n", 2}}) {
+        FILE* f = fopen(path.c_str(), "wb");
+        fputs(script.c_str(), f);
+        fclose(f);
+        check(batch_main(path.c_str(), null_out) == status, "batch exit status " + to_string(status));
+    }
+    remove(path.c_str());
+    fclose(null_out);
+}
+
+// Writes raw bytes to a scratch file.
+void write_bytes(const string& path, const vector<unsigned char>& bytes) {
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+}
+
+// Whether loading the file as Polynomial<T> throws runtime_error.
+template<typename T>
+bool load_fails(const string& path) {
+    try {
+        load_polynomial<T>(path);
+    } catch(const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// Binary polynomial files: round trips, the mapped view, and rejected files (poly_io.h).
+void test_poly_io() {
+    mt19937_64 rng(16);
+    typedef ModInt<998244353> M;
+    typedef DynModInt<> D;
+    string path = temp_path("poly.plyc");
+    for (int deg : {-1, 0, 5, 5000}) {
+        string what = " degree " + to_string(deg);
+        Polynomial<M> pm = deg < 0 ? Polynomial<M>() : random_poly<M>(deg, rng);
+        write_polynomial(path, pm);
+        check(load_polynomial<M>(path).coeffs == pm.coeffs, "ModInt round trip" + what);
+        D::set_mod(1000000007);
+        Polynomial<D> pd = deg < 0 ? Polynomial<D>() : random_poly<D>(deg, rng);
+        write_polynomial(path, pd);
+        check(load_polynomial<D>(path).coeffs == pd.coeffs, "DynModInt round trip" + what);
+        Polynomial<double> pr = deg < 0 ? Polynomial<double>() : random_poly<double>(deg, rng);
+        write_polynomial(path, pr);
+        check(load_polynomial<double>(path).coeffs == pr.coeffs, "double round trip" + what);
+    }
+    // Streaming writer, then the view reads the mapped file in place.
+    Polynomial<M> p = random_poly<M>(3000, rng);
+    {
+        PolynomialWriter<M> writer(path);
+        for (const M& c : p.coeffs)
+            writer.push(c);
+        writer.close();
+    }
+    {
+        PolynomialView<M> view(path);
+        bool same = view.size() == p.coeffs.size() && view.modulus() == 998244353;
+        for (size_t i = 0; same && i < view.size(); i++)
+            same = view[i] == p.coeffs[i] && view.raw()[i] == (uint32_t)p.coeffs[i].val();
+        check(same, "view coefficients");
+        M x(12345);
+        check(view.evaluate(x) == p.evaluate(x), "view evaluation");
+#ifdef POLY_IO_MMAP
+        if constexpr (endian::native == endian::little)
+            check(view.mapped(), "view reads the mapping without copying");
+#endif
+    }
+    // Wrong coefficient type or modulus.
+    check(load_fails<double>(path), "ModInt file rejected as double");
+    check(load_fails<D>(path), "ModInt file rejected as DynModInt");
+    check(load_fails<ModInt<1000000007>>(path), "file with another modulus rejected");
+    D::set_mod(1000000007);
+    write_polynomial(path, random_poly<D>(10, rng));
+    D::set_mod(998244353);
+    check(load_fails<D>(path), "DynModInt file rejected under another modulus");
+    // Damaged files.
+    vector<unsigned char> bytes(POLY_HEADER_SIZE);
+    encode_header(bytes.data(), {CoeffType::Residue32, 998244353, 4});
+    bytes.resize(POLY_HEADER_SIZE + 4 * sizeof(uint32_t), 0);
+    write_bytes(path, bytes);
+    check(!load_fails<M>(path), "complete file accepted");
+    write_bytes(path, vector<unsigned char>(bytes.begin(), bytes.end() - 1));
+    check(load_fails<M>(path), "truncated coefficients rejected");
+    write_bytes(path, vector<unsigned char>(bytes.begin(), bytes.begin() + POLY_HEADER_SIZE - 1));
+    check(load_fails<M>(path), "truncated header rejected");
+    write_bytes(path, {});
+    check(load_fails<M>(path), "empty file rejected");
+    vector<unsigned char> bad = bytes;
+    bad[0] = 'X';
+    write_bytes(path, bad);
+    check(load_fails<M>(path), "bad magic rejected");
+    bad = bytes;
+    bad[4] = 2;
+    write_bytes(path, bad);
+    check(load_fails<M>(path), "unknown version rejected");
+    // Batch mode save and load.
+    auto [out, failures] = run_batch_script("mod 7\nsave 3 6 0 1 " + path + "\nload " + path + "\nmod 11\nload " + path + "\n");
+    check(out == "3\n3 6 0 1\nerror Polynomial file uses modulus 7, expected 11\n", "batch save and load");
+    remove(path.c_str());
+    check(load_fails<M>(path), "missing file rejected");
+}
+
+#ifdef POLYCALC_PROFILE
+// Profiling counters (profile.h); only in builds with -DPOLYCALC_PROFILE.
+void test_profile() {
+    mt19937_64 rng(17);
+    typedef ModInt<998244353> M;
+    Polynomial<M> a = random_poly<M>(300, rng), b = random_poly<M>(120, rng);
+    auto count = [](ProfileCounter c) { return profile_snapshot()[(size_t)c]; };
+    ProfileTotals mul0 = count(ProfileCounter::PolyMul), div0 = count(ProfileCounter::PolyDivmod),
+                  alloc0 = count(ProfileCounter::CoeffAlloc);
+    Polynomial<M> c = a * b;
+    ProfileTotals mul1 = count(ProfileCounter::PolyMul), div1 = count(ProfileCounter::PolyDivmod),
+                  alloc1 = count(ProfileCounter::CoeffAlloc);
+    check(mul1.calls == mul0.calls + 1, "one product counts one poly_mul call");
+    check(mul1.nanos > mul0.nanos, "poly_mul time moves");
+    check(div1.calls == div0.calls, "a product counts no divmod");
+    check(alloc1.calls > alloc0.calls && alloc1.bytes - alloc0.bytes >= c.coeffs.size() * sizeof(M),
+          "the product's coefficients are counted as allocated");
+    auto [q, r] = c.divmod(a);
+    ProfileTotals mul2 = count(ProfileCounter::PolyMul), div2 = count(ProfileCounter::PolyDivmod),
+                  alloc2 = count(ProfileCounter::CoeffAlloc);
+    check(div2.calls == div1.calls + 1, "one divmod counts one poly_divmod call");
+    check(div2.nanos > div1.nanos, "poly_divmod time moves");
+    check(mul2.calls > mul1.calls, "Newton division counts its products");
+    check(alloc2.bytes - alloc1.bytes >= (q.coeffs.size() + r.coeffs.size()) * sizeof(M),
+          "the quotient and remainder are counted as allocated");
+    ostringstream report;
+    profile_report(report);
+    check(report.str().find("poly_divmod") != string::npos, "report lists poly_divmod");
+}
+#endif
+
+// Lazy expressions and in-place arithmetic against eager Polynomial operators (poly_expr.h).
+void test_poly_expr() {
+    mt19937_64 rng(18);
+    typedef ModInt<998244353> M;
+    for (int n : {0, 5, (int)KARATSUBA_THRESHOLD, (int)KARATSUBA_THRESHOLD + 1, 3 * (int)NTT_THRESHOLD}) {
+        Polynomial<M> a = random_poly<M>(n, rng), b = random_poly<M>(n / 2 + 3, rng),
+                      c = random_poly<M>(n + 7, rng), d = random_poly<M>(2, rng), e = random_poly<M>(n + 40, rng);
+        string what = " n=" + to_string(n);
+        Polynomial<M> dest = random_poly<M>(3, rng);
+        dest = lazy(a) * b + lazy(c) * d - e;
+        check(dest.coeffs == (a * b + c * d - e).coeffs, "sum of products" + what);
+        Polynomial<M> acc = e, want = e + a * b - c * d;
+        acc += lazy(a) * b;
+        acc -= lazy(c) * d;
+        check(acc.coeffs == want.coeffs, "accumulated products" + what);
+        // The destination inside its own expression.
+        Polynomial<M> p = a, q = b;
+        p = lazy(p) * q + p;
+        check(p.coeffs == (a * b + a).coeffs, "p = p * q + p" + what);
+        p = a;
+        p += lazy(p) * q;
+        check(p.coeffs == (a + a * b).coeffs, "p += p * q" + what);
+        p = a;
+        p -= lazy(q) * p;
+        check(p.coeffs == (a - b * a).coeffs, "p -= q * p" + what);
+        p = a;
+        p = lazy(p) * p - q;
+        check(p.coeffs == (a * a - b).coeffs, "p = p * p - q" + what);
+        dest = lazy(a) * b - lazy(b) * a;
+        check(dest.coeffs.empty(), "cancelling products normalize to zero" + what);
+        // In-place operators.
+        p = a;
+        p += c;
+        check(p.coeffs == (a + c).coeffs, "+=" + what);
+        p -= e;
+        check(p.coeffs == (a + c - e).coeffs, "-=" + what);
+        p *= b;
+        check(p.coeffs == ((a + c - e) * b).coeffs, "*=" + what);
+        check((Polynomial<M>(a) + c - e).coeffs == (a + c - e).coeffs, "rvalue chain" + what);
+        // A destination with enough capacity keeps its buffer.
+        dest.coeffs.reserve(a.coeffs.size() + b.coeffs.size() + e.coeffs.size());
+        const M* buffer = dest.coeffs.data();
+        dest = lazy(a) * b + e;
+        check(dest.coeffs.data() == buffer && dest.coeffs == (a * b + e).coeffs, "assignment reuses the buffer" + what);
+#ifdef POLYCALC_PROFILE
+        // Only buffers that are actually allocated are counted, including adopted ones.
+        auto allocs = [] { return profile_snapshot()[(size_t)ProfileCounter::CoeffAlloc]; };
+        ProfileTotals before = allocs();
+        dest = lazy(a) * b + e;
+        check(allocs().calls == before.calls,
+              "lazy assignment into a large enough buffer allocates nothing" + what);
+        before = allocs();
+        Polynomial<M> product = a * b;
+        ProfileTotals after = allocs();
+        check(after.calls > before.calls && after.bytes - before.bytes >= product.coeffs.size() * sizeof(M),
+              "the adopted product buffer is counted" + what);
+#endif
+    }
+}
+
+// Sum of fib by nested parallel_invoke, to exercise nested waits.
+long long parallel_fib(int n, ThreadPool& pool) {
+    if(n < 12)
+        return n < 2 ? n : parallel_fib(n - 1, pool) + parallel_fib(n - 2, pool);
+    long long a = 0, b = 0;
+    parallel_invoke([&] { a = parallel_fib(n - 1, pool); }, [&] { b = parallel_fib(n - 2, pool); }, pool);
+    return a + b;
+}
+
+// Work-stealing pool, task groups and the batch factor ring operations (thread_pool.h,
+// ring_batch.h). A private four-thread pool is used whatever the shared pool's size.
+void test_thread_pool() {
+    ThreadPool pool(4);
+    // Every index exactly once, for ranges and grains of all shapes.
+    for (auto [n, grain] : {pair<size_t, size_t>{0, 1}, {1, 1}, {7, 100}, {1000, 1}, {10007, 13}, {4096, 4096}}) {
+        vector<atomic<int>> hits(n);
+        parallel_for(0, n, grain, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++)
+                hits[i]++;
+        }, pool);
+        bool once = true;
+        for (size_t i = 0; i < n; i++)
+            once = once && hits[i] == 1;
+        check(once, "parallel_for visits each index once, n=" + to_string(n) + " grain=" + to_string(grain));
+    }
+    // Nested parallel_for from inside tasks.
+    atomic<size_t> total{0};
+    parallel_for(0, 64, 1, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; i++)
+            parallel_for(0, 100, 7, [&](size_t l, size_t h) { total += h - l; }, pool);
+    }, pool);
+    check(total == 6400, "nested parallel_for");
+    // The first exception is rethrown once; the other tasks still run.
+    {
+        TaskGroup group(pool);
+        atomic<int> finished{0};
+        atomic<bool> first{false};
+        group.run([&first] {
+            first = true;
+            throw runtime_error("first");
+        });
+        // The other tasks are queued once a worker has thrown the first exception.
+        while(!first)
+            this_thread::yield();
+        this_thread::sleep_for(chrono::milliseconds(20));
+        for (int i = 0; i < 8; i++)
+            group.run([&finished] {
+                this_thread::sleep_for(chrono::milliseconds(5));
+                finished++;
+                throw runtime_error("later");
+            });
+        string message;
+        try {
+            group.wait();
+        } catch(const runtime_error& e) {
+            message = e.what();
+        }
+        check(message == "first", "wait rethrows the first exception");
+        check(finished == 8, "wait waits for the other tasks");
+        bool again = false;
+        try {
+            group.wait();
+        } catch(...) {
+            again = true;
+        }
+        check(!again, "the exception is rethrown only once");
+    }
+    bool thrown = false;
+    try {
+        parallel_for(0, 100, 1, [](size_t lo, size_t) {
+            if(lo == 57)
+                throw runtime_error("index 57");
+        }, pool);
+    } catch(const runtime_error&) {
+        thrown = true;
+    }
+    check(thrown, "parallel_for rethrows a task exception");
+    {
+        TaskGroup empty(pool);
+        auto start = chrono::steady_clock::now();
+        empty.wait();
+        check(chrono::steady_clock::now() - start < chrono::seconds(1), "an empty group returns at once");
+    }
+    // parallel_invoke runs both sides, also nested.
+    bool left = false, right = false;
+    parallel_invoke([&] { left = true; }, [&] { right = true; }, pool);
+    check(left && right, "parallel_invoke runs both functions");
+    check(parallel_fib(22, pool) == 17711, "nested parallel_invoke");
+    // Batch factor ring operations on the pool against one operation per element.
+    mt19937_64 rng(6);
+    typedef DynModInt<> D;
+    D::set_mod(1000000007);
+    auto ctx = make_shared<const ModulusContext<D>>(random_irreducible<D>(20, rng));
+    vector<FactorRingElement<D>> xs, ys;
+    for (size_t i = 0; i < 3 * RING_BATCH_GRAIN + 5; i++) {
+        xs.emplace_back(random_poly<D>(19, rng), ctx);
+        ys.emplace_back(random_poly<D>(19, rng), ctx);
+    }
+    vector<FactorRingElement<D>> inv = batch_inv(xs, pool), prod = batch_mul(xs, ys, pool), pw = batch_pow(xs, 12345, pool);
+    bool same_inv = true, same_mul = true, same_pow = true;
+    for (size_t i = 0; i < xs.size(); i++) {
+        same_inv = same_inv && inv[i].poly.coeffs == xs[i].inv().poly.coeffs;
+        same_mul = same_mul && prod[i].poly.coeffs == (xs[i] * ys[i]).poly.coeffs;
+        same_pow = same_pow && pw[i].poly.coeffs == xs[i].pow(12345).poly.coeffs;
+    }
+    check(same_inv, "batch_inv matches inv");
+    check(same_mul, "batch_mul matches *");
+    check(same_pow, "batch_pow matches pow");
+}
+
+// Products and divisions large enough to run on the shared pool, against Karatsuba and
+// against the division identity (convolution.h, ntt.h).
+void test_parallel_products() {
+    mt19937_64 rng(19);
+    typedef ModInt<998244353> M;
+    for (size_t n : {KARATSUBA_PARALLEL_MIN + 1, NTT_PARALLEL_MIN / 2 + 7}) {
+        vector<M> a = random_coeffs<M>(n, rng), b = random_coeffs<M>(n + 3, rng);
+        check(convolve(a, b) == convolve_karatsuba(a, b), "ModInt large product n=" + to_string(n));
+        check(convolve(a, a) == convolve_karatsuba(a, a), "ModInt large square n=" + to_string(n));
+    }
+    typedef ModInt<1000000007> P;
+    vector<P> a = random_coeffs<P>(NTT_PARALLEL_MIN / 2 + 7, rng), b = random_coeffs<P>(NTT_PARALLEL_MIN / 2, rng);
+    check(convolve(a, b) == convolve_karatsuba(a, b), "multi-prime large product");
+    Polynomial<M> f = random_poly<M>(3 * (int)NTT_PARALLEL_MIN / 2, rng), g = random_poly<M>((int)NTT_PARALLEL_MIN / 2, rng);
+    auto [q, r] = f.divmod(g);
+    check((q * g + r).coeffs == f.coeffs && r.degree() < g.degree(), "large division");
+}
+
+// Table arithmetic of fixed GF(2^n) element types against schoolbook products (galois_field.h).
+void test_galois_field() {
+    bool same = true, inverses = true;
+    for (unsigned i = 0; i < 256; i++) {
+        GF256 x = GF256::from_index(i);
+        for (unsigned j = 0; j < 256; j++) {
+            GF256 y = GF256::from_index(j);
+            same = same && x * y == GF256::multiply(x, y);
+        }
+        if(i)
+            inverses = inverses && x * x.inv() == GF256(1);
+    }
+    check(same, "GF(2^8) table products match schoolbook");
+    check(inverses, "GF(2^8) inverses");
+    mt19937_64 rng(11);
+    same = true;
+    for (int i = 0; i < 20000; i++) {
+        GF65536 x = GF65536::from_index(rng() % 65536), y = GF65536::from_index(rng() % 65536);
+        same = same && x * y == GF65536::multiply(x, y);
+    }
+    check(same, "GF(2^16) table products match schoolbook");
+    // An odd characteristic: GF(3^5) with modulus a^5 + 2a + 1.
+    typedef GaloisField<3, 5, array<int, 5>{1, 2, 0, 0, 0}> F;
+    F g = F::generator();
+    bool primitive = g.pow(F::order() - 1) == F(1);
+    for (unsigned long long d : {2ULL, 11ULL})
+        primitive = primitive && g.pow((F::order() - 1) / d) != F(1);
+    check(primitive, "GF(3^5) generator has order 242");
+    inverses = true;
+    for (unsigned i = 1; i < F::order(); i++) {
+        F x = F::from_index(i);
+        inverses = inverses && x * x.inv() == F(1) && (x * g) / g == x;
+    }
+    check(inverses, "GF(3^5) inverses and division");
+}
+
+// Bit-packed GF(2)[x]: Karatsuba and carry-less products, division and reduction (gf2poly.h).
+void test_gf2() {
+    mt19937_64 rng(10);
+    typedef ModInt<2> B;
+    int k = 64 * GF2_KARATSUBA_WORDS;
+    for (int n : {1, 63, 64, 65, k - 1, k, k + 1, 3 * k}) {
+        for (int m : {n, 2 * n + 70}) {
+            Polynomial<B> a = random_poly<B>(n, rng), b = random_poly<B>(m, rng);
+            string what = " deg " + to_string(n) + " x " + to_string(m);
+            GF2Poly pa(a), pb(b);
+            check((pa * pb).to_polynomial().coeffs == naive_mul(a.coeffs, b.coeffs), "GF2Poly product" + what);
+            check(pa.square().to_polynomial().coeffs == naive_mul(a.coeffs, a.coeffs), "GF2Poly square" + what);
+            auto [q, r] = naive_divmod(b, a);
+            check((pb / pa).to_polynomial().coeffs == q.coeffs && (pb % pa).to_polynomial().coeffs == r.coeffs,
+                  "GF2Poly division" + what);
+        }
+    }
+    // Carry-less kernel: the portable code against the dispatcher (PCLMULQDQ when present).
+    vector<uint64_t> a(37), b(23);
+    for (auto &w : a)
+        w = rng();
+    for (auto &w : b)
+        w = rng();
+    vector<uint64_t> r1(a.size() + b.size(), 0), r2(a.size() + b.size(), 0);
+    gf2_mul_schoolbook_portable(a.data(), a.size(), b.data(), b.size(), r1.data());
+    gf2_mul_schoolbook(a.data(), a.size(), b.data(), b.size(), r2.data());
+    check(r1 == r2, "portable carry-less product matches the dispatched one");
+    // Reduction by shifted copies below the Barrett degree and by Barrett above it.
+    for (int n : {5, GF2_BARRETT_MIN_DEGREE - 1, GF2_BARRETT_MIN_DEGREE, GF2_BARRETT_MIN_DEGREE + 1}) {
+        Polynomial<B> f = random_poly<B>(n, rng), x = random_poly<B>(2 * n - 1, rng);
+        GF2Modulus ring{GF2Poly(f)};
+        check(ring.reduce(GF2Poly(x)).to_polynomial().coeffs == naive_divmod(x, f).second.coeffs,
+              "GF2Modulus reduction n=" + to_string(n));
+        // Factor rings over Z_2 multiply through the packed modulus.
+        auto ctx = make_shared<const ModulusContext<B>>(f);
+        Polynomial<B> y = random_poly<B>(n - 1, rng), z = random_poly<B>(n - 1, rng);
+        check((FactorRingElement<B>(y, ctx) * FactorRingElement<B>(z, ctx)).poly.coeffs == naive_divmod(y * z, f).second.coeffs,
+              "Z_2 factor ring product n=" + to_string(n));
+    }
+}
+
+// Truncated power series inverse, log, exp, sqrt and pow against their defining identities (power_series.h).
+void test_power_series() {
+    mt19937_64 rng(8);
+    typedef ModInt<998244353> M;
+    for (int n : {1, 2, 31, 33, (int)NTT_THRESHOLD + 1, 1000}) {
+        string what = " n=" + to_string(n);
+        Polynomial<M> f = random_poly<M>(n + 5, rng);
+        f.coeffs[0] = M(1);
+        // 1 / f by the O(n^2) recurrence.
+        vector<M> inv(n);
+        inv[0] = M(1);
+        for (int k = 1; k < n; k++) {
+            M s(0);
+            for (int j = 1; j <= k; j++)
+                s = s + f[j] * inv[k-j];
+            inv[k] = M(0) - s;
+        }
+        check(series_inv(f, n).coeffs == Polynomial<M>(inv).coeffs, "inverse" + what);
+        Polynomial<M> log_f = series_log(f, n);
+        check(series_exp(log_f, n).coeffs == f.truncated(n).coeffs, "exp(log f) = f" + what);
+        // (log f)' f = f'
+        check((series_derivative(log_f, n) * f).truncated(n - 1).coeffs == series_derivative(f, n).truncated(n - 1).coeffs,
+              "log derivative" + what);
+        Polynomial<M> g = f * Polynomial<M>(M(4));
+        Polynomial<M> root = series_sqrt(g, n);
+        check((root * root).truncated(n).coeffs == g.truncated(n).coeffs, "sqrt" + what);
+        Polynomial<M> h = random_poly<M>(6, rng);
+        for (unsigned k : {2u, 7u})
+            check(series_pow(h, k, n).coeffs == h.pow(k).truncated(n).coeffs, "pow " + to_string(k) + what);
+    }
+}
+
+// a * b modulo small primes, against the product of the residues.
+bool residues_match(const BigInt& a, const BigInt& b) {
+    BigInt c = a * b;
+    if(c.sign() != a.sign() * b.sign())
+        return false;
+    for (uint32_t p : {1000000007u, 998244353u, 65521u}) {
+        // mod_small reduces the magnitude, and |a b| = |a| |b|.
+        if(c.mod_small(p) != (uint64_t)a.mod_small(p) * b.mod_small(p) % p)
+            return false;
+    }
+    return true;
+}
+
+BigInt random_bigint(size_t bits, mt19937_64& rng) {
+    BigInt r(0);
+    for (size_t b = 0; b < bits; b += 30)
+        r = r * BigInt(1LL << 30) + BigInt((long long)(rng() & ((1ULL << 30) - 1)));
+    return rng() & 1 ? -r : r;
+}
+
+// BigInt arithmetic and exact Polynomial<BigInt> products (bigint.h).
+void test_bigint() {
+    mt19937_64 rng(9);
+    // Karatsuba starts at BIGINT_KARATSUBA_LIMBS 32-bit limbs.
+    for (size_t bits : {(size_t)30, (size_t)1000, 32 * BIGINT_KARATSUBA_LIMBS - 10, 32 * BIGINT_KARATSUBA_LIMBS + 40, (size_t)20000}) {
+        BigInt a = random_bigint(bits, rng), b = random_bigint(bits / 2 + 7, rng);
+        string what = " bits=" + to_string(bits);
+        check(residues_match(a, b), "BigInt product residues" + what);
+        check((a + b) - b == a, "BigInt sum" + what);
+        check(BigInt(a.to_string()) == a, "BigInt decimal round trip" + what);
+    }
+    // Polynomial products: direct CRT, Kronecker limb splitting and Karatsuba.
+    for (size_t len : {5, 33, 40, 120}) {
+        for (size_t bits : {20, 200, 2000}) {
+            vector<BigInt> a(len), b(len + 3);
+            for (auto &x : a)
+                x = random_bigint(bits, rng);
+            for (auto &x : b)
+                x = random_bigint(bits / 2 + 1, rng);
+            check(convolve(a, b) == naive_mul(a, b), "Polynomial<BigInt> product len=" + to_string(len) + " bits=" + to_string(bits));
+        }
+    }
+}
+
+// Factor ring powers (including BigInt exponents), inverses, the Frobenius matrix and
+// Brent-Kung composition (factor_ring.h).
+template<typename T>
+FactorRingElement<T> naive_pow(FactorRingElement<T> base, unsigned long long e) {
+    FactorRingElement<T> r(Polynomial<T>(T(1)), base.ctx);
+    for (; e; e >>= 1) {
+        if(e & 1)
+            r = r * base;
+        base = base * base;
+    }
+    return r;
+}
+
+template<typename T>
+void check_ring(const string& name, int n, mt19937_64& rng) {
+    auto ctx = make_shared<const ModulusContext<T>>(make_monic(random_poly<T>(n, rng)));
+    FactorRingElement<T> a(random_poly<T>(n - 1, rng), ctx);
+    string what = name + " n=" + to_string(n);
+    for (unsigned long long e : {0ULL, 1ULL, 5ULL, 1000000ULL, (unsigned long long)rng()})
+        check(a.pow(e).poly.coeffs == naive_pow(a, e).poly.coeffs, what + " pow " + to_string(e));
+    // 2^64 + 3 = (2^32)^2 + 3.
+    BigInt big = BigInt((long long)1 << 32) * BigInt((long long)1 << 32) + BigInt(3);
+    check(a.pow(big).poly.coeffs == (naive_pow(naive_pow(a, 1ULL << 32), 1ULL << 32) * naive_pow(a, 3)).poly.coeffs,
+          what + " pow 2^64 + 3");
+    try {
+        check((a * a.inv()).poly.coeffs == vector<T>{T(1)}, what + " inverse");
+    } catch(const runtime_error&) {
+        // a shares a factor with the random modulus; nothing to compare.
+    }
+    // Frobenius: repeated calls switch to the matrix once it pays off.
+    FactorRingElement<T> conj = a, powered = a;
+    for (int i = 0; i < 2 * n + 4; i++) {
+        conj = conj.frobenius();
+        powered = naive_pow(powered, (unsigned long long)T::mod());
+    }
+    check(conj.poly.coeffs == powered.poly.coeffs, what + " Frobenius");
+    // Brent-Kung composition against Horner's rule.
+    Polynomial<T> f = random_poly<T>(2 * n + 3, rng);
+    FactorRingElement<T> horner(Polynomial<T>(), ctx);
+    for (size_t i = f.coeffs.size(); i-- > 0;)
+        horner = horner * a + FactorRingElement<T>(Polynomial<T>(f.coeffs[i]), ctx);
+    check(a.compose(f).poly.coeffs == horner.poly.coeffs, what + " compose");
+}
+
+void test_factor_ring() {
+    mt19937_64 rng(6);
+    DynModInt<>::set_mod(1000000007);
+    for (int n : {3, DIVISION_NEWTON_THRESHOLD - 1, DIVISION_NEWTON_THRESHOLD + 1, 150})
+        check_ring<DynModInt<>>("DynModInt<1000000007>", n, rng);
+    for (int n : {70, GF2_BARRETT_MIN_DEGREE - 1, GF2_BARRETT_MIN_DEGREE + 1})
+        check_ring<ModInt<2>>("Z_2", n, rng);
+}
+
+// LRU bookkeeping of LruCache and the RingCache of verdicts, contexts and inverses
+// (result_cache.h).
+void test_result_cache() {
+    typedef ModInt<998244353> M;
+    auto key = [](int i) { return make_cache_key(Polynomial<M>(M(i))); };
+
+    LruCache<int> lru(3);
+    for (int i = 0; i < 3; i++)
+        lru.put(key(i), i);
+    check(lru.get(key(0)) == 0, "LRU get returns the stored value");
+    lru.put(key(3), 3); // evicts 1, the least recently used after the get of 0
+    check(!lru.get(key(1)) && lru.get(key(0)) == 0 && lru.get(key(2)) == 2 && lru.get(key(3)) == 3,
+          "LRU evicts the least recently used entry");
+    lru.put(key(4), 4); // 0 is now the oldest
+    check(!lru.get(key(0)) && lru.get(key(2)) == 2, "LRU get refreshes recency");
+    lru.put(key(2), 20);
+    check(lru.get(key(2)) == 20 && lru.stats().size == 3, "LRU put replaces in place");
+    CacheStats s = lru.stats();
+    check(s.hits == 6 && s.misses == 2 && s.evictions == 2 && s.capacity == 3, "LRU hit, miss and eviction counts");
+    lru.set_capacity(1);
+    s = lru.stats();
+    check(s.size == 1 && s.evictions == 4 && lru.get(key(2)) == 20, "LRU shrinking keeps the most recent entry");
+    lru.clear();
+    s = lru.stats();
+    check(s.size == 0 && s.hits == 7 && s.evictions == 4, "LRU clear keeps the statistics");
+
+    LruCache<int> tiny(0);
+    tiny.put(key(1), 1);
+    tiny.put(key(2), 2);
+    s = tiny.stats();
+    check(s.capacity == 1 && s.size == 1 && tiny.get(key(2)) == 2 && !tiny.get(key(1)), "LRU capacity 0 is clamped to 1");
+
+    int computed = 0;
+    auto compute = [&computed] { return ++computed; };
+    int first = lru.get_or_compute(key(7), compute), second = lru.get_or_compute(key(7), compute);
+    check(first == 1 && second == 1 && computed == 1, "get_or_compute computes only on a miss");
+
+    Polynomial<M> one(vector<M>{1}), one_two(vector<M>{1, 2}), two_three(vector<M>{2, 3}), three(vector<M>{3});
+    check(!(make_cache_key(one, &two_three) == make_cache_key(one_two, &three)), "cache keys record the operand lengths");
+
+    typedef DynModInt<> D;
+    D::set_mod(1000000007); // 3 mod 4, so x^2 + 1 is irreducible
+    Polynomial<D> field(vector<D>{1, 0, 1}), split(vector<D>{-1, 0, 1});
+    RingCache<D> cache;
+    cache.prewarm({field, split});
+    RingCache<D>::Stats rs = cache.stats();
+    check(rs.irreducible.size == 2 && rs.contexts.size == 2, "prewarm fills verdicts and contexts");
+    check(cache.is_irreducible(field) && !cache.is_irreducible(split), "cached irreducibility verdicts");
+    check(cache.context(field) == cache.context(field), "cached contexts are shared");
+    rs = cache.stats();
+    check(rs.irreducible.hits == 2 && rs.contexts.hits == 2 && rs.irreducible.misses == 2,
+          "lookups after prewarm are hits");
+
+    FactorRingElement<D> a = cache.element(Polynomial<D>(vector<D>{3, 5}), field);
+    check(cache.inverse(a).poly.coeffs == a.inv().poly.coeffs && cache.inverse(a).poly.coeffs == a.inv().poly.coeffs,
+          "cached inverse matches inv");
+    FactorRingElement<D> zero_divisor = cache.element(Polynomial<D>(vector<D>{-1, 1}), split);
+    int thrown = 0;
+    for (int i = 0; i < 2; i++) {
+        try {
+            cache.inverse(zero_divisor);
+        } catch(const runtime_error&) {
+            thrown++;
+        }
+    }
+    rs = cache.stats();
+    check(thrown == 2 && rs.inverses.hits == 2 && rs.inverses.misses == 2, "missing inverses are cached and rethrown");
+}
+
+int main(int argc, char* argv[]) {
+    string filter;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            cerr << "Usage: polytests [--filter S]\n";
+            return 2;
+        }
+    }
+    // The parallel kernels only split work on a shared pool with several threads.
+    if(!getenv("POLYCALC_THREADS"))
+        ThreadPool::set_shared_threads(max(4u, thread::hardware_concurrency()));
+    vector<pair<string, function<void()>>> groups = {
+        {"convolution", test_convolution},
+        {"division", test_division},
+        {"modulus_context", test_modulus_context},
+        {"dynmodint", test_dynmodint},
+        {"irreducibility", test_irreducibility},
+        {"factorization", test_factorization},
+        {"gcd", test_gcd},
+        {"multipoint", test_multipoint},
+        {"simd_eval", test_simd_eval},
+        {"fft", test_fft},
+        {"batch", test_batch},
+        {"poly_io", test_poly_io},
+#ifdef POLYCALC_PROFILE
+        {"profile", test_profile},
+#endif
+        {"poly_expr", test_poly_expr},
+        {"thread_pool", test_thread_pool},
+        {"parallel_products", test_parallel_products},
+        {"galois_field", test_galois_field},
+        {"gf2", test_gf2},
+        {"power_series", test_power_series},
+        {"bigint", test_bigint},
+        {"factor_ring", test_factor_ring},
+        {"result_cache", test_result_cache},
+    };
+    for (auto &[name, run] : groups) {
+        if(name.find(filter) == string::npos)
+            continue;
+        size_t run0 = checks_run, failed0 = checks_failed;
+        cout << name << endl;
+        run();
+        cout << "  " << checks_run - run0 << " checks, " << checks_failed - failed0 << " failed\n";
+    }
+    cout << (checks_failed ? "FAILED" : "OK") << ": " << checks_run << " checks, " << checks_failed << " failed\n";
+    return checks_failed ? 1 : 0;
+}
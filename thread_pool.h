@@ -0,0 +1,272 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+//////////////////////////////
+// thread_pool.h
+//////////////////////////////
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own tasks
+// at the back (newest first, which keeps recursive splits cache-friendly) and, when it runs
+// dry, steals from the front of the other deques (oldest, i.e. largest, tasks first).
+// Tasks submitted from outside the pool are dealt round-robin.
+//
+// A thread waiting for a TaskGroup runs queued tasks until its own group is done and
+// sleeps only while nothing is queued, so tasks may spawn and wait for nested tasks without
+// deadlocking the pool.
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads) : queues(max(1u, threads)) {
+        for (unsigned i = 0; i < queues.size(); i++)
+            workers.emplace_back([this, i] { worker_loop(i); });
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(sleep_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    unsigned size() const {
+        return queues.size();
+    }
+
+    // Queues a task; from a worker of this pool it goes onto that worker's own deque.
+    void spawn(function<void()> task) {
+        size_t q = current_pool == this ? current_index : next_queue++ % queues.size();
+        {
+            lock_guard<mutex> guard(queues[q].lock);
+            queues[q].tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> guard(sleep_lock);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    // Runs one queued task on the calling thread, if there is one.
+    bool try_run_one() {
+        function<void()> task;
+        if(!take(current_pool == this ? current_index : 0, task))
+            return false;
+        task();
+        return true;
+    }
+
+    // Runs queued tasks on the calling thread until done() holds. Between tasks it sleeps
+    // until more work is queued or notify_waiters() is called.
+    template<typename Done>
+    void run_until(Done done) {
+        while(!done()) {
+            if(try_run_one())
+                continue;
+            unique_lock<mutex> guard(sleep_lock);
+            wake.wait(guard, [&] { return queued > 0 || done(); });
+        }
+    }
+
+    // Wakes the threads in run_until to check their condition again.
+    void notify_waiters() {
+        {
+            // A waiter checks its condition under the lock, so it cannot miss the wakeup.
+            lock_guard<mutex> guard(sleep_lock);
+        }
+        wake.notify_all();
+    }
+
+    // Thread count of the shared pool; set before the first call to shared(). The default
+    // is the POLYCALC_THREADS environment variable, or else one thread per core.
+    static void set_shared_threads(unsigned threads) {
+        lock_guard<mutex> guard(shared_lock());
+        if(shared_created())
+            throw runtime_error("The shared thread pool is already running");
+        shared_threads() = threads;
+    }
+
+    // The process-wide pool used by the batch and parallel kernels.
+    static ThreadPool& shared() {
+        static ThreadPool* pool = [] {
+            lock_guard<mutex> guard(shared_lock());
+            unsigned n = shared_threads();
+            if(n == 0) {
+                const char* env = getenv("POLYCALC_THREADS");
+                n = env ? (unsigned)atoi(env) : thread::hardware_concurrency();
+            }
+            shared_created() = true;
+            return new ThreadPool(max(1u, n)); // Never destroyed: workers outlive static teardown.
+        }();
+        return *pool;
+    }
+
+private:
+    struct WorkQueue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<WorkQueue> queues;
+    vector<thread> workers;
+    atomic<size_t> next_queue{0};
+    mutex sleep_lock;
+    condition_variable wake;
+    size_t queued = 0; // Tasks in all deques, guarded by sleep_lock.
+    bool stopping = false;
+
+    static inline thread_local ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_index = 0;
+
+    static mutex& shared_lock() {
+        static mutex m;
+        return m;
+    }
+    static unsigned& shared_threads() {
+        static unsigned n = 0;
+        return n;
+    }
+    static bool& shared_created() {
+        static bool created = false;
+        return created;
+    }
+
+    // Own deque from the back, then the others from the front.
+    bool take(size_t home, function<void()>& task) {
+        for (size_t k = 0; k < queues.size(); k++) {
+            WorkQueue& q = queues[(home + k) % queues.size()];
+            lock_guard<mutex> guard(q.lock);
+            if(q.tasks.empty())
+                continue;
+            if(k == 0) {
+                task = move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            lock_guard<mutex> count_guard(sleep_lock);
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index) {
+        current_pool = this;
+        current_index = index;
+        function<void()> task;
+        while(true) {
+            if(take(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            unique_lock<mutex> guard(sleep_lock);
+            wake.wait(guard, [this] { return stopping || queued > 0; });
+            if(stopping && queued == 0)
+                return;
+        }
+    }
+};
+
+// A set of tasks that can be waited for together. The first exception thrown by a task is
+// rethrown by wait().
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    ~TaskGroup() {
+        // Tasks reference this group; never leave them running.
+        pool.run_until([this] { return pending.load() == 0; });
+    }
+
+    template<typename F>
+    void run(F&& f) {
+        pending.fetch_add(1);
+        pool.spawn([this, f = forward<F>(f)]() mutable {
+            try {
+                f();
+            } catch (...) {
+                lock_guard<mutex> guard(error_lock);
+                if(!error)
+                    error = current_exception();
+            }
+            // The pool outlives the group, which may be gone as soon as pending is zero.
+            ThreadPool& owner = pool;
+            if(pending.fetch_sub(1) == 1)
+                owner.notify_waiters();
+        });
+    }
+
+    // Helps with queued work until every task of the group has finished.
+    void wait() {
+        pool.run_until([this] { return pending.load() == 0; });
+        if(error)
+            rethrow_exception(exchange(error, nullptr));
+    }
+
+private:
+    ThreadPool& pool;
+    atomic<size_t> pending{0};
+    mutex error_lock;
+    exception_ptr error;
+};
+
+// Calls f(lo, hi) on consecutive subranges of [begin, end) of at most `grain` items, in
+// parallel. Ranges that fit in one grain run on the calling thread.
+template<typename F>
+void parallel_for(size_t begin, size_t end, size_t grain, F&& f, ThreadPool& pool = ThreadPool::shared()) {
+    grain = max<size_t>(1, grain);
+    if(end - begin <= grain || pool.size() == 1) {
+        if(begin < end)
+            f(begin, end);
+        return;
+    }
+    TaskGroup group(pool);
+    for (size_t lo = begin; lo < end; lo += grain) {
+        size_t hi = min(end, lo + grain);
+        group.run([&f, lo, hi] { f(lo, hi); });
+    }
+    group.wait();
+}
+
+// Whether work of the given size should be split across the shared pool. Below the cutoff
+// the shared pool is not even started, so small operations pay nothing.
+inline bool parallel_worthwhile(size_t size, size_t cutoff) {
+    return size >= cutoff && ThreadPool::shared().size() > 1;
+}
+
+// Runs both functions, the first one possibly on another thread.
+template<typename A, typename B>
+void parallel_invoke(A&& a, B&& b, ThreadPool& pool = ThreadPool::shared()) {
+    if(pool.size() == 1) {
+        a();
+        b();
+        return;
+    }
+    TaskGroup group(pool);
+    group.run([&a] { a(); });
+    b();
+    group.wait();
+}